@@ -0,0 +1,252 @@
+/**
+ * @file arena.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Bump allocator for everything that lives as long as a scene
+ * @details Objects are placed back to back in large blocks instead of each
+ * getting its own heap allocation. Every type gets its own pool of blocks,
+ * so the spheres of a scene sit next to each other, as do its rectangles,
+ * its BVH nodes and so on. Nothing is freed one by one; destructors run and
+ * the blocks are released when the arena goes away.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+/**
+ * @brief Readable name of a type, for the usage report
+ *
+ * @param mangled Name from std::type_info or std::type_index
+ * @return std::string Demangled name where the compiler supports it
+ */
+inline std::string type_name(const char* mangled) {
+#ifdef __GNUG__
+  int status = 0;
+  std::unique_ptr<char, void (*)(void*)> name(
+      abi::__cxa_demangle(mangled, nullptr, nullptr, &status), std::free);
+  if (status == 0 && name)
+    return name.get();
+#endif
+  return mangled;
+}
+
+/**
+ * @brief Scene lifetime allocator with one pool per type
+ *
+ */
+class arena {
+ public:
+  /**
+   * @brief Construct an empty arena
+   *
+   * @param first_block Size of the first block of each pool in bytes, later
+   * blocks double up to max_block
+   */
+  explicit arena(size_t first_block = 1024) : first_(first_block) {}
+
+  // Objects are referred to by address, the arena can't be copied
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  /**
+   * @brief Destroy every object, newest first, and release the blocks
+   *
+   */
+  ~arena() {
+    for (auto it = dtors_.rbegin(); it != dtors_.rend(); ++it)
+      it->second(it->first);
+  }
+
+  /**
+   * @brief Construct an object in the pool of its type
+   *
+   * @tparam X Type to construct
+   * @tparam Args Constructor argument types
+   * @param args Constructor arguments
+   * @return X* Object, valid for the life of the arena
+   */
+  template <typename X, typename... Args>
+  X* make(Args&&... args) {
+    // Constructors may make objects of their own, which can add pools, so
+    // hold on to the pool by index rather than by reference
+    const size_t k = pool_of(typeid(X), sizeof(X));
+    void* mem = pools_[k].take(sizeof(X), alignof(X), first_);
+    X* obj = new (mem) X(std::forward<Args>(args)...);
+    pools_[k].count++;
+    if (!std::is_trivially_destructible<X>::value)
+      dtors_.emplace_back(obj, [](void* q) { static_cast<X*>(q)->~X(); });
+    return obj;
+  }
+
+  /**
+   * @brief Number of objects made
+   *
+   * @return size_t Objects in every pool
+   */
+  size_t size() const {
+    size_t n = 0;
+    for (const pool& p : pools_)
+      n += p.count;
+    return n;
+  }
+
+  /**
+   * @brief Bytes taken by objects, padding included
+   *
+   * @return size_t Bytes used in every pool
+   */
+  size_t used() const {
+    size_t n = 0;
+    for (const pool& p : pools_)
+      n += p.used;
+    return n;
+  }
+
+  /**
+   * @brief Bytes reserved from the heap
+   *
+   * @return size_t Bytes of every block
+   */
+  size_t bytes() const {
+    size_t n = 0;
+    for (const pool& p : pools_)
+      n += p.reserved;
+    return n;
+  }
+
+  /**
+   * @brief Print the usage of the arena and of each pool
+   *
+   * @param os Stream to print to
+   */
+  void print(std::ostream& os) const {
+    size_t blocks = 0;
+    for (const pool& p : pools_)
+      blocks += p.blocks.size();
+    os << "Scene arena: " << size() << " objects, " << used() / 1024
+       << " KiB used of " << bytes() / 1024 << " KiB in " << blocks
+       << " blocks.\n";
+    for (const pool& p : pools_)
+      os << "  " << type_name(p.type.name()) << ": " << p.count << " x "
+         << p.size << " bytes\n";
+  }
+
+  /**
+   * @brief Largest block a pool grows to
+   *
+   */
+  static constexpr size_t max_block = size_t(1) << 20;
+
+ private:
+  /**
+   * @brief Blocks holding the objects of one type
+   *
+   */
+  struct pool {
+    explicit pool(const std::type_info& t, size_t s) : type(t), size(s) {}
+
+    /**
+     * @brief Bump a suitably aligned spot off the current block
+     *
+     * @param n Size of the object
+     * @param align Alignment of the object
+     * @param first Size of the first block
+     * @return void* Memory for the object
+     */
+    void* take(size_t n, size_t align, size_t first) {
+      size_t at = blocks.empty() ? 0 : offset(top, align);
+      if (blocks.empty() || at + n > cap) {
+        // Each block doubles the last, so big scenes need only a few
+        cap = blocks.empty() ? first : std::min(2 * cap, max_block);
+        cap = std::max(cap, n + align);
+        blocks.emplace_back(static_cast<char*>(::operator new(cap)));
+        reserved += cap;
+        top = 0;
+        at = offset(0, align);
+      }
+      used += at + n - top;
+      top = at + n;
+      return blocks.back().get() + at;
+    }
+
+    /**
+     * @brief First offset at or past pos in the current block whose
+     * address is a multiple of align
+     *
+     */
+    size_t offset(size_t pos, size_t align) const {
+      const uintptr_t base = reinterpret_cast<uintptr_t>(blocks.back().get());
+      return static_cast<size_t>(((base + pos + align - 1) & ~(align - 1)) -
+                                 base);
+    }
+
+    /**
+     * @brief Releases a block
+     *
+     */
+    struct release {
+      void operator()(char* b) const { ::operator delete(b); }
+    };
+
+    std::type_index type;
+    size_t size;
+    size_t count{0};
+    size_t used{0};
+    size_t reserved{0};
+    size_t top{0};
+    size_t cap{0};
+    std::vector<std::unique_ptr<char, release>> blocks;
+  };
+
+  /**
+   * @brief Find the pool of a type, adding it on first use
+   *
+   * @param t Type of the object
+   * @param size Size of the object
+   * @return size_t Index of the pool of the type
+   */
+  size_t pool_of(const std::type_info& t, size_t size) {
+    const std::type_index key(t);
+    for (size_t k = 0; k < pools_.size(); k++)
+      if (pools_[k].type == key)
+        return k;
+    pools_.emplace_back(t, size);
+    return pools_.size() - 1;
+  }
+
+  /**
+   * @brief Size of the first block of each pool
+   *
+   */
+  size_t first_;
+  /**
+   * @brief Pools in order of first use
+   *
+   */
+  std::vector<pool> pools_;
+  /**
+   * @brief Destructors still to run, in order of construction
+   *
+   */
+  std::vector<std::pair<void*, void (*)(void*)>> dtors_;
+};
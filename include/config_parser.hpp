@@ -11,10 +11,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include "vec3.hpp"
 
 // template <typename T>
@@ -59,6 +63,13 @@ class parser {
    */
   void parse_data(const std::string&);
 
+  /**
+   * @brief Hash of the settings, to tell whether two processes render the
+   * same image
+   *
+   */
+  uint64_t fingerprint(const std::vector<std::string>&) const;
+
  private:
   /**
    * @brief Name of the configuration file
@@ -108,3 +119,37 @@ void parser::parse_data(const std::string& file) {
     }
   input.close();
 }
+
+/**
+ * @brief Hash of the settings, to tell whether two processes render the
+ * same image
+ * @details FNV-1a over every setting in name order, so comments and the
+ * order of the file don't matter.
+ *
+ * @param ignore Settings left out, those that don't change the pixels
+ * @return uint64_t Hash
+ */
+inline uint64_t parser::fingerprint(
+    const std::vector<std::string>& ignore) const {
+  std::vector<std::string> lines;
+  char buf[96];
+  for (const auto& d : data_) {
+    if (std::find(ignore.begin(), ignore.end(), d.first) != ignore.end())
+      continue;
+    std::snprintf(buf, sizeof(buf), "%a", d.second);
+    lines.push_back(d.first + "=" + buf);
+  }
+  for (const auto& v : vec_data_) {
+    std::snprintf(buf, sizeof(buf), "%a,%a,%a", v.second[0], v.second[1],
+                  v.second[2]);
+    lines.push_back(v.first + "=" + buf);
+  }
+  std::sort(lines.begin(), lines.end());
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (const std::string& l : lines)
+    for (const char c : l + "\n") {
+      h ^= static_cast<unsigned char>(c);
+      h *= 0x100000001b3ull;
+    }
+  return h;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file async_writer.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Output stage running on its own thread
+ * @details Writes (checkpoints, progressive images) are queued as jobs and
+ * run one at a time, in the order they were queued, on a thread of their
+ * own. The render goes on while they encode and wait on the disk. The queue
+ * is bounded: should the disk fall behind by more than a few jobs, queueing
+ * waits for room rather than piling up copies of the image in memory.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Single background thread running write jobs in order
+ *
+ */
+class async_writer {
+ public:
+  /**
+   * @brief Construct a new async writer object and start its thread
+   *
+   * @param capacity Most jobs waiting at once
+   */
+  explicit async_writer(const size_t& capacity = 2)
+      : cap_(capacity > 0 ? capacity : 1),
+        thread_(&async_writer::loop, this) {}
+
+  /**
+   * @brief Destroy the async writer object, after the jobs still queued
+   *
+   */
+  ~async_writer() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    thread_.join();
+  }
+
+  async_writer(const async_writer&) = delete;
+  async_writer& operator=(const async_writer&) = delete;
+
+  /**
+   * @brief Queue a job, waiting for room if the queue is full
+   *
+   * @param job Write to run, it owns whatever it writes
+   */
+  void push(std::function<void()> job) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    room_.wait(lock, [this] { return jobs_.size() < cap_; });
+    jobs_.push_back(std::move(job));
+    ready_.notify_one();
+  }
+
+  /**
+   * @brief Wait until every job queued so far has run
+   *
+   */
+  void wait() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    room_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+  }
+
+ private:
+  /**
+   * @brief Run jobs as they come, until stopped with the queue empty
+   *
+   */
+  void loop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (;;) {
+      ready_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty())
+        return;
+      std::function<void()> job = std::move(jobs_.front());
+      jobs_.pop_front();
+      busy_ = true;
+      room_.notify_all();
+      lock.unlock();
+      job();
+      lock.lock();
+      busy_ = false;
+      room_.notify_all();
+    }
+  }
+
+  /**
+   * @brief Most jobs waiting at once
+   *
+   */
+  size_t cap_;
+  /**
+   * @brief Guards the queue and the flags
+   *
+   */
+  std::mutex mtx_;
+  /**
+   * @brief Signals a queued job or the stop
+   *
+   */
+  std::condition_variable ready_;
+  /**
+   * @brief Signals room in the queue or a finished job
+   *
+   */
+  std::condition_variable room_;
+  /**
+   * @brief Jobs waiting, oldest first
+   *
+   */
+  std::deque<std::function<void()>> jobs_;
+  /**
+   * @brief Whether a job is running
+   *
+   */
+  bool busy_{false};
+  /**
+   * @brief Whether the writer is shutting down
+   *
+   */
+  bool stop_{false};
+  /**
+   * @brief Thread running the jobs, started last
+   *
+   */
+  std::thread thread_;
+};
@@ -0,0 +1,515 @@
+/**
+ * @file deflate.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Deflate compressor and the checksums of zlib and PNG
+ * @details A plain LZ77 and dynamic Huffman compressor (RFC 1951), enough to
+ * write PNG files without a library. A buffer is compressed one slice at a
+ * time, each slice on its own. Every slice but the last ends on a byte
+ * boundary with an empty stored block, as a zlib sync flush does, and may
+ * refer back to the 32 KB before it. Slices compressed on separate threads
+ * and laid end to end are one valid deflate stream, whose Adler-32 is put
+ * together from the slices' with adler32_combine.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Update a CRC-32 (ISO-HDLC, as PNG and zip use) with some bytes
+ *
+ * @param crc CRC of the bytes so far, 0 to start
+ * @param p Bytes
+ * @param n Number of bytes
+ * @return uint32_t CRC including the bytes
+ */
+inline uint32_t crc32(uint32_t crc, const uint8_t* p, size_t n) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < n; i++)
+    crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+/**
+ * @brief Update an Adler-32 with some bytes
+ *
+ * @param adler Adler-32 of the bytes so far, 1 to start
+ * @param p Bytes
+ * @param n Number of bytes
+ * @return uint32_t Adler-32 including the bytes
+ */
+inline uint32_t adler32(uint32_t adler, const uint8_t* p, size_t n) {
+  constexpr uint32_t base = 65521;
+  uint32_t a = adler & 0xffff, b = adler >> 16;
+  while (n > 0) {
+    // The most bytes that can be summed before b might overflow
+    const size_t k = std::min<size_t>(n, 5552);
+    for (size_t i = 0; i < k; i++) {
+      a += p[i];
+      b += a;
+    }
+    a %= base;
+    b %= base;
+    p += k;
+    n -= k;
+  }
+  return a | (b << 16);
+}
+
+/**
+ * @brief Adler-32 of two runs of bytes one after the other, from the
+ * Adler-32 of each
+ *
+ * @param a1 Adler-32 of the first run
+ * @param a2 Adler-32 of the second run
+ * @param len2 Length of the second run
+ * @return uint32_t Adler-32 of both runs
+ */
+inline uint32_t adler32_combine(const uint32_t& a1,
+                                const uint32_t& a2,
+                                const size_t& len2) {
+  constexpr uint32_t base = 65521;
+  const uint32_t rem = static_cast<uint32_t>(len2 % base);
+  uint32_t s1 = a1 & 0xffff;
+  uint32_t s2 = static_cast<uint32_t>((uint64_t(rem) * s1) % base);
+  s1 += (a2 & 0xffff) + base - 1;
+  s2 += (a1 >> 16) + (a2 >> 16) + base - rem;
+  while (s1 >= base)
+    s1 -= base;
+  while (s2 >= base)
+    s2 -= base;
+  return s1 | (s2 << 16);
+}
+
+/**
+ * @brief Writer of a deflate bit stream, least significant bit first
+ *
+ */
+class bit_writer {
+ public:
+  /**
+   * @brief Construct a new bit writer object appending to a buffer
+   *
+   * @param out Buffer
+   */
+  explicit bit_writer(std::string& out) : out_(out) {}
+
+  /**
+   * @brief Append the low bits of a value
+   *
+   * @param bits Value
+   * @param n Number of bits, at most 32
+   */
+  void put(const uint32_t& bits, const int& n) {
+    acc_ |= static_cast<uint64_t>(bits) << n_;
+    n_ += n;
+    while (n_ >= 8) {
+      out_.push_back(static_cast<char>(acc_ & 0xff));
+      acc_ >>= 8;
+      n_ -= 8;
+    }
+  }
+
+  /**
+   * @brief Pad with zero bits up to the next byte
+   *
+   */
+  void align() {
+    if (n_ > 0)
+      put(0, 8 - n_);
+  }
+
+ private:
+  std::string& out_;
+  uint64_t acc_{0};
+  int n_{0};
+};
+
+/**
+ * @brief Deflate compressor of slices of one buffer
+ *
+ */
+class deflater {
+ public:
+  /**
+   * @brief Construct a new deflater object
+   *
+   * @param max_chain Longest hash chain searched for a match, more is
+   * slower and smaller
+   */
+  explicit deflater(const int& max_chain = 128) : chain_(max_chain) {}
+
+  /**
+   * @brief Compress the slice [begin, end) of a buffer
+   *
+   * @param data Whole buffer
+   * @param size Size of the whole buffer
+   * @param begin First byte of the slice
+   * @param end One past the last byte of the slice
+   * @param out Buffer to append the compressed slice to
+   */
+  void compress(const uint8_t* data,
+                const size_t& size,
+                const size_t& begin,
+                const size_t& end,
+                std::string& out) {
+    data_ = data;
+    size_ = size;
+    head_.assign(hash_size, -1);
+    prev_.assign(window, -1);
+    for (size_t p = begin > window ? begin - window : 0; p < begin; p++)
+      insert(p);
+
+    bit_writer bw(out);
+    tokens_.clear();
+    for (size_t p = begin; p < end;) {
+      std::pair<int, int> m = find(p, end);
+      insert(p);
+      // Take a literal instead if a longer match starts at the next byte
+      if (m.first >= min_match && m.first < lazy_len && p + 1 < end) {
+        const std::pair<int, int> next = find(p + 1, end);
+        if (next.first > m.first) {
+          tokens_.push_back({data[p], 0});
+          m = next;
+          insert(++p);
+        }
+      }
+      if (m.first >= min_match) {
+        tokens_.push_back({static_cast<uint16_t>(m.first),
+                           static_cast<uint16_t>(m.second)});
+        for (size_t q = p + 1; q < p + m.first; q++)
+          insert(q);
+        p += m.first;
+      } else {
+        tokens_.push_back({data[p], 0});
+        p++;
+      }
+      if (tokens_.size() >= block_tokens) {
+        write_block(bw, false);
+        tokens_.clear();
+      }
+    }
+    const bool last = end == size;
+    if (!tokens_.empty() || last)
+      write_block(bw, last);
+    if (!last) {
+      // Empty stored block, so the next slice starts on a byte
+      bw.put(0, 3);
+      bw.align();
+      bw.put(0xffff0000u, 32);
+    }
+    bw.align();
+  }
+
+ private:
+  /**
+   * @brief A literal byte (dist 0) or a match of len bytes dist back
+   *
+   */
+  struct token {
+    uint16_t len;
+    uint16_t dist;
+  };
+
+  static constexpr size_t window = 32768;
+  static constexpr size_t hash_size = 1 << 15;
+  static constexpr int min_match = 3;
+  static constexpr int max_match = 258;
+  // Matches this long are taken without looking one byte further
+  static constexpr int lazy_len = 32;
+  static constexpr size_t block_tokens = 1 << 15;
+
+  /**
+   * @brief Hash of the three bytes at p
+   *
+   */
+  uint32_t hash(const size_t& p) const {
+    const uint32_t v = data_[p] | (data_[p + 1] << 8) | (data_[p + 2] << 16);
+    return (v * 2654435761u) >> 17;
+  }
+
+  /**
+   * @brief Put position p at the head of its hash chain
+   *
+   */
+  void insert(const size_t& p) {
+    if (p + min_match > size_)
+      return;
+    int32_t& h = head_[hash(p)];
+    prev_[p & (window - 1)] = h;
+    h = static_cast<int32_t>(p);
+  }
+
+  /**
+   * @brief Find the longest match for the bytes at p that ends before end
+   *
+   * @return std::pair<int, int> Length and distance, length 0 for none
+   */
+  std::pair<int, int> find(const size_t& p, const size_t& end) const {
+    std::pair<int, int> best{0, 0};
+    const int limit = static_cast<int>(
+        std::min<size_t>(max_match, end - p));
+    if (limit < min_match)
+      return best;
+    int32_t cand = head_[hash(p)];
+    for (int n = chain_; cand >= 0 && n > 0; n--) {
+      const size_t c = static_cast<size_t>(cand);
+      if (c >= p || p - c > window)
+        break;
+      if (data_[c + best.first] == data_[p + best.first]) {
+        int len = 0;
+        while (len < limit && data_[c + len] == data_[p + len])
+          len++;
+        if (len > best.first) {
+          best = {len, static_cast<int>(p - c)};
+          if (len == limit)
+            break;
+        }
+      }
+      const int32_t next = prev_[c & (window - 1)];
+      // The chain entry was overwritten by a later position
+      if (next >= cand)
+        break;
+      cand = next;
+    }
+    return best;
+  }
+
+  /**
+   * @brief Lengths of a Huffman code for some symbol counts, none longer
+   * than limit
+   * @details Counts are halved until the code fits. A lone symbol gets a
+   * partner, so every code is complete as inflaters want it.
+   *
+   */
+  static std::vector<uint8_t> code_lengths(std::vector<uint32_t> freq,
+                                           const int& limit) {
+    const size_t n = freq.size();
+    std::vector<uint8_t> len(n, 0);
+    for (;;) {
+      using node = std::pair<uint64_t, int>;
+      std::priority_queue<node, std::vector<node>, std::greater<node>> q;
+      std::vector<int> parent;
+      std::vector<int> leaf;
+      for (size_t s = 0; s < n; s++)
+        if (freq[s] > 0) {
+          q.push({freq[s], static_cast<int>(parent.size())});
+          parent.push_back(-1);
+          leaf.push_back(static_cast<int>(s));
+        }
+      if (leaf.size() < 2) {
+        const size_t s = leaf.empty() ? 0 : leaf[0];
+        len[s] = 1;
+        len[s == 0 ? 1 : 0] = 1;
+        return len;
+      }
+      while (q.size() > 1) {
+        const node a = q.top();
+        q.pop();
+        const node b = q.top();
+        q.pop();
+        const int id = static_cast<int>(parent.size());
+        parent.push_back(-1);
+        parent[a.second] = id;
+        parent[b.second] = id;
+        q.push({a.first + b.first, id});
+      }
+      // Parents come after their children, so depths go from the root down
+      std::vector<int> depth(parent.size(), 0);
+      for (size_t k = parent.size() - 1; k-- > 0;)
+        depth[k] = depth[parent[k]] + 1;
+      int longest = 0;
+      for (size_t k = 0; k < leaf.size(); k++)
+        longest = std::max(longest, depth[k]);
+      if (longest <= limit) {
+        for (size_t k = 0; k < leaf.size(); k++)
+          len[leaf[k]] = static_cast<uint8_t>(depth[k]);
+        return len;
+      }
+      for (uint32_t& f : freq)
+        if (f > 0)
+          f = (f >> 1) | 1;
+    }
+  }
+
+  /**
+   * @brief Canonical codes of some code lengths, bit reversed for a least
+   * significant bit first stream
+   *
+   */
+  static std::vector<uint16_t> codes(const std::vector<uint8_t>& len) {
+    uint16_t count[16] = {0}, next[16] = {0};
+    for (uint8_t l : len)
+      count[l]++;
+    count[0] = 0;
+    for (int b = 1, code = 0; b < 16; b++) {
+      code = (code + count[b - 1]) << 1;
+      next[b] = static_cast<uint16_t>(code);
+    }
+    std::vector<uint16_t> out(len.size(), 0);
+    for (size_t s = 0; s < len.size(); s++) {
+      if (len[s] == 0)
+        continue;
+      uint16_t c = next[len[s]]++, r = 0;
+      for (int b = 0; b < len[s]; b++, c >>= 1)
+        r = static_cast<uint16_t>((r << 1) | (c & 1));
+      out[s] = r;
+    }
+    return out;
+  }
+
+  /**
+   * @brief Length code of a match length, and its extra bits
+   *
+   */
+  static int length_code(const int& len, int& extra, int& bits) {
+    static const uint16_t base[29] = {3,  4,  5,  6,   7,   8,   9,   10,
+                                      11, 13, 15, 17,  19,  23,  27,  31,
+                                      35, 43, 51, 59,  67,  83,  99,  115,
+                                      131, 163, 195, 227, 258};
+    static const uint8_t nbits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                      1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                      4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const int c = static_cast<int>(
+        std::upper_bound(base, base + 29, len) - base - 1);
+    extra = len - base[c];
+    bits = nbits[c];
+    return 257 + c;
+  }
+
+  /**
+   * @brief Distance code of a match distance, and its extra bits
+   *
+   */
+  static int dist_code(const int& dist, int& extra, int& bits) {
+    static const uint16_t base[30] = {
+        1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+        33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+        1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+    const int c = static_cast<int>(
+        std::upper_bound(base, base + 30, dist) - base - 1);
+    extra = dist - base[c];
+    bits = c < 4 ? 0 : c / 2 - 1;
+    return c;
+  }
+
+  /**
+   * @brief Write the tokens as one block with dynamic Huffman codes
+   *
+   */
+  void write_block(bit_writer& bw, const bool& last) const {
+    std::vector<uint32_t> lf(286, 0), df(30, 0);
+    int extra, bits;
+    for (const token& t : tokens_) {
+      if (t.dist == 0) {
+        lf[t.len]++;
+      } else {
+        lf[length_code(t.len, extra, bits)]++;
+        df[dist_code(t.dist, extra, bits)]++;
+      }
+    }
+    lf[256] = 1;
+    const std::vector<uint8_t> ll = code_lengths(lf, 15);
+    const std::vector<uint8_t> dl = code_lengths(df, 15);
+    const std::vector<uint16_t> lc = codes(ll), dc = codes(dl);
+
+    size_t hlit = 286, hdist = 30;
+    while (hlit > 257 && ll[hlit - 1] == 0)
+      hlit--;
+    while (hdist > 1 && dl[hdist - 1] == 0)
+      hdist--;
+
+    // Both code lengths in a row, run length coded: 16 repeats the last
+    // length 3-6 times, 17 and 18 give 3-10 and 11-138 zeros
+    std::vector<uint8_t> lens(ll.begin(), ll.begin() + hlit);
+    lens.insert(lens.end(), dl.begin(), dl.begin() + hdist);
+    std::vector<std::pair<uint8_t, uint8_t>> rle;
+    for (size_t i = 0; i < lens.size();) {
+      size_t run = 1;
+      while (i + run < lens.size() && lens[i + run] == lens[i])
+        run++;
+      if (lens[i] == 0 && run >= 3) {
+        const size_t k = std::min<size_t>(run, 138);
+        rle.push_back(k >= 11 ? std::make_pair(uint8_t{18},
+                                               static_cast<uint8_t>(k - 11))
+                              : std::make_pair(uint8_t{17},
+                                               static_cast<uint8_t>(k - 3)));
+        i += k;
+      } else if (lens[i] != 0 && run >= 4) {
+        rle.push_back({lens[i], 0});
+        const size_t k = std::min<size_t>(run - 1, 6);
+        rle.push_back({16, static_cast<uint8_t>(k - 3)});
+        i += 1 + k;
+      } else {
+        rle.push_back({lens[i], 0});
+        i++;
+      }
+    }
+    std::vector<uint32_t> cf(19, 0);
+    for (const auto& r : rle)
+      cf[r.first]++;
+    const std::vector<uint8_t> cl = code_lengths(cf, 7);
+    const std::vector<uint16_t> cc = codes(cl);
+    static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+    size_t hclen = 19;
+    while (hclen > 4 && cl[order[hclen - 1]] == 0)
+      hclen--;
+
+    bw.put(last ? 1 : 0, 1);
+    bw.put(2, 2);
+    bw.put(static_cast<uint32_t>(hlit - 257), 5);
+    bw.put(static_cast<uint32_t>(hdist - 1), 5);
+    bw.put(static_cast<uint32_t>(hclen - 4), 4);
+    for (size_t i = 0; i < hclen; i++)
+      bw.put(cl[order[i]], 3);
+    for (const auto& r : rle) {
+      bw.put(cc[r.first], cl[r.first]);
+      if (r.first >= 16)
+        bw.put(r.second, r.first == 16 ? 2 : r.first == 17 ? 3 : 7);
+    }
+
+    for (const token& t : tokens_) {
+      if (t.dist == 0) {
+        bw.put(lc[t.len], ll[t.len]);
+        continue;
+      }
+      const int l = length_code(t.len, extra, bits);
+      bw.put(lc[l], ll[l]);
+      bw.put(static_cast<uint32_t>(extra), bits);
+      const int d = dist_code(t.dist, extra, bits);
+      bw.put(dc[d], dl[d]);
+      bw.put(static_cast<uint32_t>(extra), bits);
+    }
+    bw.put(lc[256], ll[256]);
+  }
+
+  int chain_;
+  const uint8_t* data_{nullptr};
+  size_t size_{0};
+  std::vector<int32_t> head_;
+  std::vector<int32_t> prev_;
+  std::vector<token> tokens_;
+};
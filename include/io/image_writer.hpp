@@ -0,0 +1,325 @@
+/**
+ * @file image_writer.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Writers of finished images: text and binary PPM, PNG, PFM and
+ * OpenEXR
+ * @details Every format is put together in memory and handed to the stream
+ * in one write. PPM and PNG (see png_writer.hpp) take a tonemapped image,
+ * PFM and OpenEXR keep the linear radiance: PFM as 32 bit floats, OpenEXR
+ * as an uncompressed half float scanline file, the least any OpenEXR
+ * reader accepts. Binary values are written little endian whatever the
+ * host.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#include "io/png_writer.hpp"
+#include "render/image.hpp"
+#include "render/thread_pool.hpp"
+
+/**
+ * @brief Output file formats
+ *
+ */
+enum class image_format { ppm_text, ppm, pfm, exr, png };
+
+/**
+ * @brief Return the format of a number, as the config gives it
+ *
+ * @param id 0: text .ppm, 1: binary .ppm, 2: .pfm, 3: OpenEXR, 4: .png
+ * @return image_format Format
+ */
+inline image_format format_of(const int& id) {
+  return id >= 4   ? image_format::png
+         : id == 3 ? image_format::exr
+         : id == 2 ? image_format::pfm
+         : id == 1 ? image_format::ppm
+                   : image_format::ppm_text;
+}
+
+/**
+ * @brief Return the usual file extension of a format
+ *
+ * @param f Format
+ * @return const char* Extension, with the dot
+ */
+inline const char* extension(const image_format& f) {
+  switch (f) {
+    case image_format::pfm:
+      return ".pfm";
+    case image_format::exr:
+      return ".exr";
+    case image_format::png:
+      return ".png";
+    default:
+      return ".ppm";
+  }
+}
+
+/**
+ * @brief Append an integer to a buffer, little endian
+ *
+ * @tparam U Unsigned integer type
+ * @param buf Buffer
+ * @param v Value
+ */
+template <typename U>
+void put_le(std::string& buf, const U& v) {
+  for (size_t k = 0; k < sizeof(U); k++)
+    buf.push_back(static_cast<char>((v >> (8 * k)) & 0xff));
+}
+
+/**
+ * @brief Append a float to a buffer, little endian
+ *
+ * @param buf Buffer
+ * @param f Value
+ */
+inline void put_le(std::string& buf, const float& f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  put_le<uint32_t>(buf, x);
+}
+
+/**
+ * @brief Convert a float to a half float, rounding to nearest even
+ * @details Values past the largest half turn to infinity and values below
+ * the smallest subnormal half to zero. NaNs stay NaNs.
+ *
+ * @param f Value
+ * @return uint16_t Bits of the half float
+ */
+inline uint16_t to_half(const float& f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  const uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000);
+  const uint32_t mag = x & 0x7fffffff;
+  if (mag >= 0x7f800000)
+    return sign | (mag > 0x7f800000 ? 0x7e00 : 0x7c00);
+  if (mag >= 0x47800000)
+    return sign | 0x7c00;
+  uint32_t h, rem, half;
+  if (mag < 0x38800000) {
+    // Subnormal half, in units of 2^-24
+    const int e = static_cast<int>(mag >> 23);
+    if (e < 102)
+      return sign;
+    const uint32_t m = (mag & 0x7fffff) | 0x800000;
+    const int shift = 126 - e;
+    h = m >> shift;
+    rem = m & ((1u << shift) - 1);
+    half = 1u << (shift - 1);
+  } else {
+    // Rebias the exponent from 127 to 15 and drop 13 bits of mantissa, a
+    // carry out of the mantissa rounds up into the exponent
+    h = (mag - 0x38000000) >> 13;
+    rem = mag & 0x1fff;
+    half = 0x1000;
+  }
+  if (rem > half || (rem == half && (h & 1)))
+    h++;
+  return static_cast<uint16_t>(sign | h);
+}
+
+/**
+ * @brief Write a text .ppm (P3), one pixel per line
+ *
+ * @param out Ostream to print out to
+ * @param img Tonemapped image
+ * @return true The image was written
+ * @return false The stream failed
+ */
+inline bool write_ppm_text(std::ostream& out, const ldr_image& img) {
+  std::string buf = "P3\n" + std::to_string(img.width) + " " +
+                    std::to_string(img.height) + "\n255\n";
+  buf.reserve(buf.size() + img.rgb.size() * 4);
+  for (size_t k = 0; k < img.rgb.size(); k++) {
+    const unsigned v = img.rgb[k];
+    if (v >= 100)
+      buf.push_back(static_cast<char>('0' + v / 100));
+    if (v >= 10)
+      buf.push_back(static_cast<char>('0' + v / 10 % 10));
+    buf.push_back(static_cast<char>('0' + v % 10));
+    buf.push_back(k % 3 == 2 ? '\n' : ' ');
+  }
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  return static_cast<bool>(out);
+}
+
+/**
+ * @brief Write a binary .ppm (P6)
+ *
+ * @param out Binary ostream to write to
+ * @param img Tonemapped image
+ * @return true The image was written
+ * @return false The stream failed
+ */
+inline bool write_ppm(std::ostream& out, const ldr_image& img) {
+  std::string buf = "P6\n" + std::to_string(img.width) + " " +
+                    std::to_string(img.height) + "\n255\n";
+  buf.append(reinterpret_cast<const char*>(img.rgb.data()), img.rgb.size());
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  return static_cast<bool>(out);
+}
+
+/**
+ * @brief Write a .pfm of 32 bit floats, bottom row first as the format
+ * wants it
+ *
+ * @param out Binary ostream to write to
+ * @param img Linear image
+ * @return true The image was written
+ * @return false The stream failed
+ */
+inline bool write_pfm(std::ostream& out, const hdr_image& img) {
+  // A negative scale marks the data as little endian
+  std::string buf = "PF\n" + std::to_string(img.width) + " " +
+                    std::to_string(img.height) + "\n-1.0\n";
+  const size_t row = static_cast<size_t>(img.width) * 3;
+  buf.reserve(buf.size() + img.rgb.size() * sizeof(float));
+  for (int j = img.height - 1; j >= 0; --j)
+    for (size_t k = 0; k < row; k++)
+      put_le(buf, img.rgb[j * row + k]);
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  return static_cast<bool>(out);
+}
+
+/**
+ * @brief Write an uncompressed half float OpenEXR file, top row first
+ *
+ * @param out Binary ostream to write to
+ * @param img Linear image
+ * @return true The image was written
+ * @return false The stream failed
+ */
+inline bool write_exr(std::ostream& out, const hdr_image& img) {
+  const int32_t w = img.width, h = img.height;
+  std::string buf;
+  put_le<uint32_t>(buf, 20000630);  // magic number
+  put_le<uint32_t>(buf, 2);         // version 2, single part scanlines
+
+  // Header attributes: name, type, size in bytes and value
+  auto attr = [&](const char* name, const char* type, const int32_t& size) {
+    buf.append(name).push_back('\0');
+    buf.append(type).push_back('\0');
+    put_le<uint32_t>(buf, static_cast<uint32_t>(size));
+  };
+  // Channels are stored in alphabetical order, as half floats
+  attr("channels", "chlist", 3 * 18 + 1);
+  for (const char* c : {"B", "G", "R"}) {
+    buf.append(c).push_back('\0');
+    put_le<uint32_t>(buf, 1);  // HALF
+    put_le<uint32_t>(buf, 0);  // pLinear and reserved bytes
+    put_le<uint32_t>(buf, 1);  // x sampling
+    put_le<uint32_t>(buf, 1);  // y sampling
+  }
+  buf.push_back('\0');
+  attr("compression", "compression", 1);
+  buf.push_back('\0');  // none
+  for (const char* name : {"dataWindow", "displayWindow"}) {
+    attr(name, "box2i", 16);
+    put_le<uint32_t>(buf, 0);
+    put_le<uint32_t>(buf, 0);
+    put_le<uint32_t>(buf, static_cast<uint32_t>(w - 1));
+    put_le<uint32_t>(buf, static_cast<uint32_t>(h - 1));
+  }
+  attr("lineOrder", "lineOrder", 1);
+  buf.push_back('\0');  // increasing y, top row first
+  attr("pixelAspectRatio", "float", 4);
+  put_le(buf, 1.0f);
+  attr("screenWindowCenter", "v2f", 8);
+  put_le(buf, 0.0f);
+  put_le(buf, 0.0f);
+  attr("screenWindowWidth", "float", 4);
+  put_le(buf, 1.0f);
+  buf.push_back('\0');
+
+  // Offset of every scanline from the start of the file, then the lines:
+  // their y, their size and the B, G and R halves of their pixels
+  const uint32_t line = static_cast<uint32_t>(w) * 3 * 2;
+  const uint64_t first = buf.size() + static_cast<uint64_t>(h) * 8;
+  for (int32_t j = 0; j < h; j++)
+    put_le<uint64_t>(buf, first + static_cast<uint64_t>(j) * (8 + line));
+  buf.reserve(first + static_cast<size_t>(h) * (8 + line));
+  for (int32_t j = 0; j < h; j++) {
+    put_le<uint32_t>(buf, static_cast<uint32_t>(j));
+    put_le<uint32_t>(buf, line);
+    const float* row = img.rgb.data() + static_cast<size_t>(j) * w * 3;
+    for (int c = 2; c >= 0; --c)
+      for (int32_t i = 0; i < w; i++)
+        put_le<uint16_t>(buf, to_half(row[i * 3 + c]));
+  }
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  return static_cast<bool>(out);
+}
+
+/**
+ * @brief Write an image in a format, tonemapping it first for the formats
+ * that need it
+ *
+ * @param out Binary ostream to write to
+ * @param img Linear image
+ * @param f Format
+ * @param pool Thread pool for the formats that encode in parallel, nullptr
+ * for this thread only
+ * @return true The image was written
+ * @return false The stream failed
+ */
+inline bool write_image(std::ostream& out,
+                        const hdr_image& img,
+                        const image_format& f,
+                        thread_pool* pool = nullptr) {
+  switch (f) {
+    case image_format::png:
+      return write_png(out, tonemap(img), pool);
+    case image_format::pfm:
+      return write_pfm(out, img);
+    case image_format::exr:
+      return write_exr(out, img);
+    case image_format::ppm:
+      return write_ppm(out, tonemap(img));
+    default:
+      return write_ppm_text(out, tonemap(img));
+  }
+}
+
+/**
+ * @brief Write an image to a file, in place of any older one only once it
+ * is complete
+ *
+ * @param path File to write
+ * @param img Linear image
+ * @param f Format
+ * @param pool Thread pool for the formats that encode in parallel, nullptr
+ * for this thread only
+ * @return true The image is in place
+ * @return false It couldn't be written, the old file is left alone
+ */
+inline bool save_image(const std::string& path,
+                       const hdr_image& img,
+                       const image_format& f,
+                       thread_pool* pool = nullptr) {
+  const std::string tmp = path + ".tmp";
+  std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+  if (!out || !write_image(out, img, f, pool))
+    return false;
+  // The last of it may only fail to reach the disk on close (e.g a full
+  // disk), a short file must never replace a good one
+  out.close();
+  if (!out) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file mapped_file.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Read-only memory mapping of a file
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ *
+ */
+class mapped_file {
+ public:
+  /**
+   * @brief Map a file into memory
+   *
+   * @param path Name of the file
+   * @param sequential Whether the file will be read front to back
+   */
+  explicit mapped_file(const std::string& path, bool sequential = false) {
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+      return;
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0)
+      return;
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                   MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED)
+      return;
+    data_ = static_cast<const char*>(p);
+    size_ = static_cast<size_t>(st.st_size);
+    // Let the kernel read ahead aggressively
+    if (sequential)
+      madvise(p, size_, MADV_SEQUENTIAL);
+  }
+
+  /**
+   * @brief Unmap and close the file
+   *
+   */
+  ~mapped_file() {
+    if (data_)
+      munmap(const_cast<char*>(data_), size_);
+    if (fd_ >= 0)
+      close(fd_);
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  /**
+   * @brief Whether the file could be opened
+   *
+   * @return true The file is open (it may still be empty)
+   * @return false The file could not be opened
+   */
+  bool is_open() const { return fd_ >= 0; }
+  /**
+   * @brief Return the first byte of the file
+   *
+   * @return const char* Start of the mapping, null for an empty file
+   */
+  const char* data() const { return data_; }
+  /**
+   * @brief Return the size of the file
+   *
+   * @return size_t Size in bytes
+   */
+  size_t size() const { return size_; }
+
+ private:
+  /**
+   * @brief File descriptor
+   *
+   */
+  int fd_{-1};
+  /**
+   * @brief Start of the mapping
+   *
+   */
+  const char* data_{nullptr};
+  /**
+   * @brief Size of the mapping in bytes
+   *
+   */
+  size_t size_{0};
+};
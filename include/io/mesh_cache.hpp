@@ -0,0 +1,464 @@
+/**
+ * @file mesh_cache.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Binary, memory-mappable cache of a parsed mesh and its BVH
+ * @details A mesh loaded from source.obj is written next to it as
+ * source.obj.rtmesh: a fixed header followed by the vertex positions, the
+ * triangle indices in BVH leaf order, the flattened BVH nodes and the
+ * triangle batches of its leaves, each section 64 byte aligned. The file is
+ * mapped and used in place, so loading a cached mesh costs a stat and an
+ * mmap. The cache is trusted when the size and modification time of the
+ * source match the header; if only the time changed the source is hashed
+ * and compared against the stored hash.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "io/mapped_file.hpp"
+#include "objects/linear_bvh.hpp"
+#include "objects/tri_batch.hpp"
+
+/**
+ * @brief Header at the start of a mesh cache file
+ *
+ */
+struct mesh_cache_header {
+  /**
+   * @brief Identifies the file, "RTMESH" padded with zeros
+   *
+   */
+  char magic[8];
+  /**
+   * @brief Layout version, bumped on any change to the format
+   *
+   */
+  uint32_t version;
+  /**
+   * @brief 0x01020304 in the byte order of the writer
+   *
+   */
+  uint32_t endian;
+  /**
+   * @brief sizeof(T) of the vertices
+   *
+   */
+  uint32_t real_size;
+  /**
+   * @brief Triangles per batch of the writer
+   *
+   */
+  uint32_t lanes;
+  /**
+   * @brief Size, modification time (ns) and FNV-1a hash of the source
+   *
+   */
+  uint64_t src_size;
+  int64_t src_mtime;
+  uint64_t src_hash;
+  /**
+   * @brief Hash of the options the BVH was built with
+   *
+   */
+  uint64_t bvh_key;
+  /**
+   * @brief Number of vertices, indices and BVH nodes
+   *
+   */
+  uint64_t n_verts, n_ids, n_nodes;
+  /**
+   * @brief Byte offsets of the vertex, index and node sections
+   *
+   */
+  uint64_t off_verts, off_ids, off_nodes;
+  /**
+   * @brief Shape of the BVH
+   *
+   */
+  uint64_t leaves, max_depth, max_leaf;
+  /**
+   * @brief Number of triangle batches
+   *
+   */
+  uint64_t n_batches;
+  /**
+   * @brief Byte offsets of the batches and of the leaf to batch map
+   *
+   */
+  uint64_t off_batches, off_first;
+};
+
+/**
+ * @brief Current layout version of the cache
+ *
+ */
+constexpr uint32_t mesh_cache_version = 2;
+
+/**
+ * @brief 64 bit FNV-1a hash
+ *
+ * @param p Bytes to hash
+ * @param n Number of bytes
+ * @param h Hash to continue from
+ * @return uint64_t Hash
+ */
+inline uint64_t fnv1a(const void* p,
+                      size_t n,
+                      uint64_t h = 0xcbf29ce484222325ULL) {
+  const unsigned char* c = static_cast<const unsigned char*>(p);
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ c[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+/**
+ * @brief Hash the BVH options that change the shape of a built tree
+ *
+ * @param opt Build options
+ * @return uint64_t Hash
+ */
+inline uint64_t bvh_key(const bvh_options& opt) {
+  const int split = static_cast<int>(opt.split);
+  const uint64_t leaf = opt.leaf_size;
+  const uint64_t batch = opt.batch;
+  uint64_t h = fnv1a(&split, sizeof(split));
+  h = fnv1a(&opt.bins, sizeof(opt.bins), h);
+  h = fnv1a(&leaf, sizeof(leaf), h);
+  h = fnv1a(&batch, sizeof(batch), h);
+  h = fnv1a(&opt.traversal_cost, sizeof(opt.traversal_cost), h);
+  return fnv1a(&opt.intersect_cost, sizeof(opt.intersect_cost), h);
+}
+
+/**
+ * @brief Size and modification time of a file
+ *
+ */
+struct file_stamp {
+  uint64_t size = 0;
+  int64_t mtime = 0;
+};
+
+/**
+ * @brief Read the size and modification time of a file
+ *
+ * @param path Name of the file
+ * @param out Size and modification time
+ * @return true The file exists
+ * @return false The file could not be read
+ */
+inline bool stamp_file(const std::string& path, file_stamp& out) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return false;
+  out.size = static_cast<uint64_t>(st.st_size);
+  out.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+              st.st_mtim.tv_nsec;
+  return true;
+}
+
+/**
+ * @brief Hash the contents of a file
+ *
+ * @param path Name of the file
+ * @param out FNV-1a hash of the contents
+ * @return true The file was read
+ * @return false The file could not be read
+ */
+inline bool hash_file(const std::string& path, uint64_t& out) {
+  mapped_file map(path, true);
+  if (!map.is_open())
+    return false;
+  out = fnv1a(map.data(), map.size());
+  return true;
+}
+
+/**
+ * @brief Return the name of the cache of a mesh file
+ *
+ * @param src Name of the mesh file
+ * @return std::string Name of the cache
+ */
+inline std::string mesh_cache_path(const std::string& src) {
+  return src + ".rtmesh";
+}
+
+/**
+ * @brief Views into a mapped mesh cache
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct mesh_cache {
+  /**
+   * @brief Mapping that every view points into
+   *
+   */
+  std::shared_ptr<mapped_file> map;
+  const point3<T>* verts = nullptr;
+  const uint32_t* ids = nullptr;
+  /**
+   * @brief BVH nodes, null when built with other options
+   *
+   */
+  const lbvh_node* nodes = nullptr;
+  /**
+   * @brief Triangle batches and leaf map, null without the nodes or when the
+   * batch width differs
+   *
+   */
+  const tri_batch* batches = nullptr;
+  const uint32_t* first = nullptr;
+  size_t n_verts = 0, n_ids = 0, n_nodes = 0, n_batches = 0;
+  /**
+   * @brief Shape of the cached BVH
+   *
+   */
+  bvh_stats stats;
+};
+
+/**
+ * @brief Check that every index in the views of a cache stays in range
+ * @details One pass over the indices, the nodes and the batches, so a
+ * corrupt or foreign cache is turned down instead of read out of bounds.
+ * The nodes must form one tree stored depth first, left child right after
+ * its parent, no deeper than the traversal stack.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param c Views into the cache
+ * @return true Every index is in range
+ * @return false Some index points outside its section
+ */
+template <typename T>
+bool mesh_cache_sane(const mesh_cache<T>& c) {
+  for (size_t k = 0; k < c.n_ids; k++)
+    if (c.ids[k] >= c.n_verts)
+      return false;
+  if (!c.nodes)
+    return true;
+
+  const uint64_t tris = c.n_ids / 3;
+  for (size_t k = 0; k < c.n_batches; k++)
+    for (const uint32_t& id : c.batches[k].id)
+      if (id != UINT32_MAX && id >= tris)
+        return false;
+
+  // Walking the tree depth first must meet the nodes in stored order
+  std::vector<std::pair<uint32_t, int>> todo{{0, 0}};
+  uint64_t next = 0;
+  while (!todo.empty()) {
+    const auto [i, depth] = todo.back();
+    todo.pop_back();
+    if (i >= c.n_nodes || i != next++)
+      return false;
+    const lbvh_node& nd = c.nodes[i];
+    if (nd.count > 0) {
+      if (uint64_t{nd.offset} + nd.count > tris)
+        return false;
+      const uint64_t runs = (nd.count + tri_lanes - 1) / tri_lanes;
+      if (c.batches && uint64_t{c.first[nd.offset]} + runs > c.n_batches)
+        return false;
+    } else {
+      if (nd.offset <= i + 1 || depth + 1 > flat_bvh<T>::max_depth)
+        return false;
+      todo.push_back({nd.offset, depth + 1});
+      todo.push_back({i + 1, depth + 1});
+    }
+  }
+  return next == c.n_nodes;
+}
+
+/**
+ * @brief Map the cache of a mesh file if it is still valid
+ * @details The vertices and indices are only usable when the cache matches
+ * the source and the datatype. The nodes are only handed out when they were
+ * built with the same options; otherwise the caller rebuilds the BVH over the
+ * cached indices. Likewise the batches need the nodes and the same width.
+ * A cache whose indices don't check out (see mesh_cache_sane) is not used.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param src Name of the mesh file
+ * @param opt Options the BVH should be built with
+ * @param out Views into the cache
+ * @return true The cache is valid
+ * @return false There is no valid cache
+ */
+template <typename T>
+bool open_mesh_cache(const std::string& src,
+                     const bvh_options& opt,
+                     mesh_cache<T>& out) {
+  file_stamp st;
+  if (!stamp_file(src, st))
+    return false;
+  const std::string path = mesh_cache_path(src);
+  auto map = std::make_shared<mapped_file>(path);
+  if (map->size() < sizeof(mesh_cache_header))
+    return false;
+
+  mesh_cache_header h;
+  std::memcpy(&h, map->data(), sizeof(h));
+  if (std::memcmp(h.magic, "RTMESH", 7) != 0 ||
+      h.version != mesh_cache_version || h.endian != 0x01020304 ||
+      h.real_size != sizeof(T) || h.src_size != st.size)
+    return false;
+
+  // Sections must lie inside the file
+  const uint64_t size = map->size();
+  auto fits = [size](uint64_t off, uint64_t n, uint64_t elem) {
+    return off % 64 == 0 && off <= size && n <= (size - off) / elem;
+  };
+  if (!fits(h.off_verts, h.n_verts, sizeof(point3<T>)) ||
+      !fits(h.off_ids, h.n_ids, sizeof(uint32_t)) ||
+      !fits(h.off_nodes, h.n_nodes, sizeof(lbvh_node)) ||
+      !fits(h.off_batches, h.n_batches, sizeof(tri_batch)) ||
+      !fits(h.off_first, h.n_batches ? h.n_ids / 3 : 0, sizeof(uint32_t)) ||
+      h.n_ids % 3 != 0)
+    return false;
+
+  if (h.src_mtime != st.mtime) {
+    // Touched but maybe not changed, compare contents
+    uint64_t hash;
+    if (!hash_file(src, hash) || hash != h.src_hash)
+      return false;
+    // Remember the new time so the next load skips the hash
+    int fd = open(path.c_str(), O_WRONLY);
+    if (fd >= 0) {
+      const off_t at = offsetof(mesh_cache_header, src_mtime);
+      if (pwrite(fd, &st.mtime, sizeof(st.mtime), at) < 0)
+        perror("Error updating mesh cache");
+      close(fd);
+    }
+  }
+
+  const char* base = map->data();
+  out.verts = reinterpret_cast<const point3<T>*>(base + h.off_verts);
+  out.ids = reinterpret_cast<const uint32_t*>(base + h.off_ids);
+  out.n_verts = h.n_verts;
+  out.n_ids = h.n_ids;
+  out.nodes = nullptr;
+  out.batches = nullptr;
+  out.first = nullptr;
+  out.n_nodes = out.n_batches = 0;
+  if (h.n_nodes > 0 && h.bvh_key == bvh_key(opt)) {
+    out.nodes = reinterpret_cast<const lbvh_node*>(base + h.off_nodes);
+    out.n_nodes = h.n_nodes;
+    if (h.n_batches > 0 && h.lanes == tri_lanes) {
+      out.batches = reinterpret_cast<const tri_batch*>(base + h.off_batches);
+      out.first = reinterpret_cast<const uint32_t*>(base + h.off_first);
+      out.n_batches = h.n_batches;
+    }
+  }
+  out.stats = bvh_stats();
+  out.stats.prims = h.n_ids / 3;
+  out.stats.nodes = h.n_nodes;
+  out.stats.leaves = h.leaves;
+  out.stats.max_depth = h.max_depth;
+  out.stats.max_leaf = h.max_leaf;
+  out.map = map;
+  return mesh_cache_sane(out);
+}
+
+/**
+ * @brief Write the cache of a mesh file
+ * @details The cache is written to a temporary file of this process and
+ * renamed over the old one once closed, so a reader never maps a half
+ * written cache.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param src Name of the mesh file
+ * @param opt Options the BVH was built with
+ * @param verts Vertex positions
+ * @param n_verts Number of vertices
+ * @param ids Triangle indices in BVH leaf order
+ * @param n_ids Number of indices
+ * @param tree BVH over the triangles
+ * @param batches Triangle batches of the tree's leaves
+ * @return true The cache was written
+ * @return false The cache could not be written
+ */
+template <typename T>
+bool write_mesh_cache(const std::string& src,
+                      const bvh_options& opt,
+                      const point3<T>* verts,
+                      size_t n_verts,
+                      const uint32_t* ids,
+                      size_t n_ids,
+                      const flat_bvh<T>& tree,
+                      const tri_batches& batches) {
+  file_stamp st;
+  mesh_cache_header h;
+  std::memset(&h, 0, sizeof(h));
+  if (!stamp_file(src, st) || !hash_file(src, h.src_hash))
+    return false;
+
+  auto align = [](uint64_t x) { return (x + 63) / 64 * 64; };
+  std::memcpy(h.magic, "RTMESH", 7);
+  h.version = mesh_cache_version;
+  h.endian = 0x01020304;
+  h.real_size = sizeof(T);
+  h.lanes = tri_lanes;
+  h.src_size = st.size;
+  h.src_mtime = st.mtime;
+  h.bvh_key = bvh_key(opt);
+  h.n_verts = n_verts;
+  h.n_ids = n_ids;
+  h.n_nodes = tree.size();
+  h.off_verts = align(sizeof(h));
+  h.off_ids = align(h.off_verts + n_verts * sizeof(point3<T>));
+  h.off_nodes = align(h.off_ids + n_ids * sizeof(uint32_t));
+  h.leaves = tree.stats().leaves;
+  h.max_depth = tree.stats().max_depth;
+  h.max_leaf = tree.stats().max_leaf;
+  h.n_batches = batches.size();
+  h.off_batches = align(h.off_nodes + tree.size() * sizeof(lbvh_node));
+  h.off_first = align(h.off_batches + batches.size() * sizeof(tri_batch));
+
+  const std::string path = mesh_cache_path(src);
+  // Processes sharing a directory (see render/shard.hpp) may all cache the
+  // same mesh at once, each writes its own temporary
+  char host[256] = "host";
+  gethostname(host, sizeof(host) - 1);
+  const std::string tmp = path + "." + host + "." +
+                          std::to_string(getpid()) + ".tmp";
+  std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+  const char zero[64] = {};
+  auto section = [&](uint64_t off, const void* p, size_t n) {
+    out.write(zero, static_cast<std::streamsize>(off - out.tellp()));
+    out.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+  };
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  section(h.off_verts, verts, n_verts * sizeof(point3<T>));
+  section(h.off_ids, ids, n_ids * sizeof(uint32_t));
+  section(h.off_nodes, tree.data(), tree.size() * sizeof(lbvh_node));
+  section(h.off_batches, batches.data(), batches.size() * sizeof(tri_batch));
+  section(h.off_first, batches.first(),
+          (batches.size() ? n_ids / 3 : 0) * sizeof(uint32_t));
+  out.close();
+  if (!out) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,356 @@
+/**
+ * @file obj_loader.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Fast, memory-mapped reader for Wavefront .obj meshes
+ * @details The file is mapped into memory and parsed in place: numbers are
+ * read straight out of the mapping, so no line, token or string is ever
+ * allocated. The file is cut into chunks on line boundaries which are parsed
+ * in parallel and then stitched back together. Only vertex positions and
+ * faces are kept; faces may use the v, v/vt, v//vn and v/vt/vn forms,
+ * negative (relative) indices and any number of corners.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io/mapped_file.hpp"
+#include "render/thread_pool.hpp"
+#include "vec3.hpp"
+
+/**
+ * @brief Vertices and triangles read from a .obj file
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct obj_data {
+  /**
+   * @brief Vertex positions
+   *
+   */
+  std::vector<point3<T>> verts;
+  /**
+   * @brief Three 0-based vertex indices per triangle
+   *
+   */
+  std::vector<uint32_t> ids;
+};
+
+/**
+ * @brief Skip spaces and tabs
+ *
+ * @param p Current position
+ * @param end End of the buffer
+ * @return const char* First character that is not a space or tab
+ */
+inline const char* obj_skip_space(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t'))
+    ++p;
+  return p;
+}
+
+/**
+ * @brief Whether a character ends a token
+ *
+ * @param c Character to test
+ * @return true The character is whitespace
+ * @return false The character is part of a token
+ */
+inline bool obj_is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief Parse a signed integer in place
+ *
+ * @param p Current position, moved past the integer
+ * @param end End of the buffer
+ * @param out Parsed value
+ * @return true An integer was read
+ * @return false No digits were found
+ */
+inline bool obj_parse_int(const char*& p, const char* end, int64_t& out) {
+  bool neg = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = *p++ == '-';
+  const char* start = p;
+  int64_t v = 0;
+  while (p < end && *p >= '0' && *p <= '9')
+    v = v * 10 + (*p++ - '0');
+  out = neg ? -v : v;
+  return p != start;
+}
+
+/**
+ * @brief Parse a decimal floating point number in place
+ * @details Numbers with at most 19 significant digits and a small exponent
+ * are converted with a single multiply or divide by an exact power of ten,
+ * which rounds exactly like strtod. Anything else (long mantissas, huge
+ * exponents, inf, nan) is copied to a small buffer and handed to strtod.
+ *
+ * @param p Current position, moved past the number
+ * @param end End of the buffer
+ * @param out Parsed value
+ * @return true A number was read
+ * @return false No number was found
+ */
+inline bool obj_parse_double(const char*& p, const char* end, double& out) {
+  static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                 1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* start = p;
+  bool neg = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    neg = *p++ == '-';
+
+  uint64_t mant = 0;
+  int digits = 0, exp = 0;
+  bool any = false, exact = true;
+  for (; p < end && *p >= '0' && *p <= '9'; ++p, any = true) {
+    if (digits < 19) {
+      mant = mant * 10 + (*p - '0');
+      digits += mant != 0;
+    } else {
+      ++exp;
+      exact = false;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && *p >= '0' && *p <= '9'; ++p, any = true) {
+      if (digits < 19) {
+        mant = mant * 10 + (*p - '0');
+        digits += mant != 0;
+        --exp;
+      } else {
+        exact = false;
+      }
+    }
+  }
+
+  if (any && p < end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    int64_t e;
+    if (obj_parse_int(q, end, e)) {
+      p = q;
+      // Clamp so absurd exponents cannot overflow, strtod handles them
+      e = std::max<int64_t>(-100000, std::min<int64_t>(e, 100000));
+      exp += static_cast<int>(e);
+    }
+  }
+
+  if (any && exact && mant <= (uint64_t(1) << 53) && exp >= -22 &&
+      exp <= 22) {
+    double v = static_cast<double>(mant);
+    v = exp < 0 ? v / pow10[-exp] : v * pow10[exp];
+    out = neg ? -v : v;
+    return true;
+  }
+
+  // Slow path, strtod needs a terminated copy of the token
+  p = start;
+  while (p < end && !obj_is_space(*p))
+    ++p;
+  char buf[64];
+  const size_t len = std::min<size_t>(p - start, sizeof(buf) - 1);
+  std::memcpy(buf, start, len);
+  buf[len] = '\0';
+  char* stop;
+  out = std::strtod(buf, &stop);
+  return stop != buf;
+}
+
+/**
+ * @brief Vertices and faces parsed from one chunk of a .obj file
+ * @details Positive face indices are absolute. Negative indices count back
+ * from the vertices read so far, which depends on the chunks before this
+ * one, so they are stored relative to the chunk's first vertex and offset
+ * by rel_bias until the chunks are merged.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct obj_chunk {
+  /**
+   * @brief Offset marking an index as relative to the chunk
+   *
+   */
+  static constexpr int64_t rel_bias = int64_t(1) << 62;
+
+  /**
+   * @brief Vertex positions of the chunk
+   *
+   */
+  std::vector<point3<T>> verts;
+  /**
+   * @brief Three vertex indices per triangle, absolute or biased relative
+   *
+   */
+  std::vector<int64_t> ids;
+  /**
+   * @brief Whether a malformed line was found
+   *
+   */
+  bool bad{false};
+};
+
+/**
+ * @brief Parse the lines of one chunk of a .obj file
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param p Start of the chunk, at the start of a line
+ * @param end End of the chunk, just past a newline or at the end of the file
+ * @param out Parsed vertices and faces
+ */
+template <typename T>
+void parse_obj_chunk(const char* p, const char* end, obj_chunk<T>& out) {
+  while (p < end) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (!eol)
+      eol = end;
+    p = obj_skip_space(p, eol);
+
+    if (eol - p > 1 && (p[1] == ' ' || p[1] == '\t')) {
+      if (p[0] == 'v') {
+        double x[3];
+        const char* q = p + 1;
+        bool ok = true;
+        for (int k = 0; k < 3 && ok; k++) {
+          q = obj_skip_space(q, eol);
+          ok = obj_parse_double(q, eol, x[k]);
+        }
+        if (ok)
+          out.verts.push_back(point3<T>(x[0], x[1], x[2]));
+        else
+          out.bad = true;
+      } else if (p[0] == 'f') {
+        // Triangulate polygons as a fan around their first corner
+        const int64_t local = static_cast<int64_t>(out.verts.size());
+        int64_t first = 0, prev = 0, v;
+        int corners = 0;
+        const char* q = obj_skip_space(p + 1, eol);
+        while (q < eol && !obj_is_space(*q)) {
+          if (!obj_parse_int(q, eol, v) || v == 0) {
+            out.bad = true;
+            break;
+          }
+          v = v > 0 ? v - 1 : local + v - obj_chunk<T>::rel_bias;
+          // Skip the texture and normal indices
+          while (q < eol && !obj_is_space(*q))
+            ++q;
+          q = obj_skip_space(q, eol);
+
+          if (corners == 0)
+            first = v;
+          else if (corners >= 2) {
+            out.ids.push_back(first);
+            out.ids.push_back(prev);
+            out.ids.push_back(v);
+          }
+          prev = v;
+          ++corners;
+        }
+        if (corners < 3)
+          out.bad = true;
+      }
+    }
+    if (eol == end)
+      break;
+    p = eol + 1;
+  }
+}
+
+/**
+ * @brief Load the vertices and triangles of a .obj file
+ * @details Files larger than a few MiB are split into chunks on line
+ * boundaries and parsed over a thread pool; smaller files are parsed on the
+ * calling thread. A file that cannot be opened is reported with perror and
+ * yields an empty mesh.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param file Name of the .obj file
+ * @param threads Number of threads, 0 uses every hardware thread
+ * @return obj_data<T> Vertices and triangles
+ */
+template <typename T>
+obj_data<T> load_obj(const std::string& file, unsigned threads = 0) {
+  obj_data<T> out;
+  mapped_file map(file, true);
+  if (!map.is_open()) {
+    perror("Error opening mesh file");
+    return out;
+  }
+  const char* begin = map.data();
+  const char* end = begin + map.size();
+
+  // Keep chunks large enough that splitting them is worth a thread
+  const size_t min_chunk = size_t(1) << 22;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  const size_t n = std::max<size_t>(
+      1, std::min<size_t>(4 * threads, map.size() / min_chunk));
+
+  // Move every cut forward to the start of the next line
+  std::vector<const char*> cuts(n + 1, end);
+  cuts[0] = begin;
+  for (size_t i = 1; i < n; i++) {
+    const char* c = begin + map.size() * i / n;
+    c = std::max(c, cuts[i - 1]);
+    const char* eol = static_cast<const char*>(std::memchr(c, '\n', end - c));
+    cuts[i] = eol ? eol + 1 : end;
+  }
+
+  std::vector<obj_chunk<T>> chunks(n);
+  thread_pool pool(static_cast<unsigned>(std::min<size_t>(threads, n)));
+  pool.run(n, [&](size_t i, size_t) {
+    parse_obj_chunk(cuts[i], cuts[i + 1], chunks[i]);
+  });
+
+  // Each chunk's vertices and faces start after those of earlier chunks
+  std::vector<size_t> vbase(n + 1, 0), ibase(n + 1, 0);
+  for (size_t i = 0; i < n; i++) {
+    if (chunks[i].bad)
+      throw std::invalid_argument("Malformed vertex or face in " + file);
+    vbase[i + 1] = vbase[i] + chunks[i].verts.size();
+    ibase[i + 1] = ibase[i] + chunks[i].ids.size();
+  }
+  const size_t nv = vbase[n];
+  if (nv > UINT32_MAX)
+    throw std::length_error("Too many vertices in " + file);
+
+  out.verts.resize(nv);
+  out.ids.resize(ibase[n]);
+  std::vector<char> bad(n, 0);
+  pool.run(n, [&](size_t i, size_t) {
+    obj_chunk<T>& c = chunks[i];
+    std::copy(c.verts.begin(), c.verts.end(), out.verts.begin() + vbase[i]);
+    for (size_t k = 0; k < c.ids.size(); k++) {
+      int64_t v = c.ids[k];
+      if (v < 0)
+        v += obj_chunk<T>::rel_bias + static_cast<int64_t>(vbase[i]);
+      if (v < 0 || static_cast<size_t>(v) >= nv)
+        bad[i] = 1;
+      out.ids[ibase[i] + k] = static_cast<uint32_t>(v);
+    }
+    std::vector<point3<T>>().swap(c.verts);
+    std::vector<int64_t>().swap(c.ids);
+  });
+  if (std::find(bad.begin(), bad.end(), 1) != bad.end())
+    throw std::out_of_range("Face index out of range in " + file);
+
+  return out;
+}
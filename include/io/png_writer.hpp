@@ -0,0 +1,169 @@
+/**
+ * @file png_writer.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief PNG writer with its own deflate, filtering and compressing bands of
+ * rows in parallel
+ * @details The image is cut into bands of rows. Each band is filtered, then
+ * compressed as a slice of one zlib stream (see deflate.hpp), on the workers
+ * of a thread pool. Every band becomes its own IDAT chunk, with its CRC
+ * taken by the worker that compressed it. Bands have a fixed size, so the
+ * file does not depend on the number of threads.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "io/deflate.hpp"
+#include "render/image.hpp"
+#include "render/thread_pool.hpp"
+
+/**
+ * @brief Filter one row of an 8 bit RGB image the PNG way
+ * @details Every filter is tried and the one leaving the smallest sum of
+ * absolute values is kept, the usual heuristic of libpng.
+ *
+ * @param row Row to filter
+ * @param up Row above, nullptr for the first row
+ * @param n Bytes in a row
+ * @param out Filter type and the n filtered bytes
+ */
+inline void png_filter_row(const uint8_t* row,
+                           const uint8_t* up,
+                           const size_t& n,
+                           uint8_t* out) {
+  constexpr size_t bpp = 3;
+  auto paeth = [](int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+  };
+  std::vector<uint8_t> trial(n);
+  uint64_t best = UINT64_MAX;
+  for (uint8_t f = 0; f < 5; f++) {
+    uint64_t sum = 0;
+    for (size_t k = 0; k < n; k++) {
+      const int a = k >= bpp ? row[k - bpp] : 0;
+      const int b = up ? up[k] : 0;
+      const int c = up && k >= bpp ? up[k - bpp] : 0;
+      const int pred = f == 1   ? a
+                       : f == 2 ? b
+                       : f == 3 ? (a + b) / 2
+                       : f == 4 ? paeth(a, b, c)
+                                : 0;
+      trial[k] = static_cast<uint8_t>(row[k] - pred);
+      sum += static_cast<uint64_t>(std::abs(static_cast<int8_t>(trial[k])));
+    }
+    if (sum < best) {
+      best = sum;
+      out[0] = f;
+      std::copy(trial.begin(), trial.end(), out + 1);
+    }
+  }
+}
+
+/**
+ * @brief Write an 8 bit RGB .png
+ *
+ * @param out Binary ostream to write to
+ * @param img Tonemapped image
+ * @param pool Thread pool to spread the bands over, nullptr for this thread
+ * only
+ * @return true The image was written
+ * @return false The stream failed
+ */
+inline bool write_png(std::ostream& out,
+                      const ldr_image& img,
+                      thread_pool* pool = nullptr) {
+  const size_t row = static_cast<size_t>(img.width) * 3;
+  const size_t line = row + 1;
+  const size_t h = static_cast<size_t>(img.height);
+  // Bands of about 128 KB, enough to keep the cost of the flush between
+  // them small
+  const size_t band_rows = std::max<size_t>(1, (128 << 10) / line);
+  const size_t bands = (h + band_rows - 1) / band_rows;
+
+  std::vector<uint8_t> filtered(line * h);
+  std::vector<std::string> chunk(bands);
+  std::vector<uint32_t> adler(bands, 1);
+  auto run = [&](const std::function<void(size_t, size_t)>& job) {
+    if (pool)
+      pool->run(bands, job);
+    else
+      for (size_t b = 0; b < bands; b++)
+        job(b, 0);
+  };
+
+  // Filtering and compressing are separate runs: a band may refer back to
+  // the filtered rows of the band before it
+  run([&](size_t b, size_t) {
+    const size_t j1 = std::min(h, (b + 1) * band_rows);
+    for (size_t j = b * band_rows; j < j1; j++) {
+      const uint8_t* r = img.rgb.data() + j * row;
+      png_filter_row(r, j > 0 ? r - row : nullptr, row,
+                     filtered.data() + j * line);
+    }
+  });
+  run([&](size_t b, size_t) {
+    const size_t begin = b * band_rows * line;
+    const size_t end = std::min(h, (b + 1) * band_rows) * line;
+    std::string& c = chunk[b];
+    c.assign(4, '\0');  // length, filled in below
+    c += "IDAT";
+    if (b == 0)
+      c += "\x78\x9c";  // zlib header: deflate, 32 KB window
+    deflater().compress(filtered.data(), filtered.size(), begin, end, c);
+    adler[b] = adler32(1, filtered.data() + begin, end - begin);
+  });
+
+  uint32_t check = 1;
+  for (size_t b = 0; b < bands; b++) {
+    const size_t len = std::min(h, (b + 1) * band_rows) * line -
+                       b * band_rows * line;
+    check = b == 0 ? adler[0] : adler32_combine(check, adler[b], len);
+  }
+  auto put_be = [](std::string& s, const uint32_t& v, const size_t& at) {
+    for (int k = 0; k < 4; k++)
+      s[at + k] = static_cast<char>((v >> (24 - 8 * k)) & 0xff);
+  };
+  chunk.back().append(4, '\0');
+  put_be(chunk.back(), check, chunk.back().size() - 4);
+  run([&](size_t b, size_t) {
+    std::string& c = chunk[b];
+    put_be(c, static_cast<uint32_t>(c.size() - 8), 0);
+    const uint32_t crc = crc32(
+        0, reinterpret_cast<const uint8_t*>(c.data()) + 4, c.size() - 4);
+    c.append(4, '\0');
+    put_be(c, crc, c.size() - 4);
+  });
+
+  // Signature, header, the bands and the end, in one write
+  std::string file = "\x89PNG\r\n\x1a\n";
+  std::string ihdr(4, '\0');
+  ihdr += "IHDR";
+  ihdr.append(8, '\0');
+  put_be(ihdr, 13, 0);
+  put_be(ihdr, static_cast<uint32_t>(img.width), 8);
+  put_be(ihdr, static_cast<uint32_t>(img.height), 12);
+  ihdr += std::string("\x08\x02\x00\x00\x00", 5);  // 8 bit RGB
+  ihdr.append(4, '\0');
+  put_be(ihdr,
+         crc32(0, reinterpret_cast<const uint8_t*>(ihdr.data()) + 4, 17),
+         21);
+  file += ihdr;
+  for (const std::string& c : chunk)
+    file += c;
+  file += std::string("\0\0\0\0IEND\xae\x42\x60\x82", 12);
+  out.write(file.data(), static_cast<std::streamsize>(file.size()));
+  return static_cast<bool>(out);
+}
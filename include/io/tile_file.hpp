@@ -0,0 +1,213 @@
+/**
+ * @file tile_file.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Raw float tiles of a render split over processes, and putting them
+ * back together
+ * @details A tile file holds a window of an image: the size of the whole
+ * image, the place of the window, a fingerprint of the settings it was
+ * rendered with, then the linear radiance of every pixel as three 32 bit
+ * floats and its samples as a 32 bit count, top row first. Everything is
+ * little endian, so tiles can be rendered on one machine and merged on
+ * another.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "io/image_writer.hpp"
+#include "render/image.hpp"
+
+/**
+ * @brief A window of a rendered image, with where it goes
+ * @details Columns and rows count from the top left corner of the image,
+ * as in the written image, and the window ends before x1 and y1.
+ *
+ */
+struct image_tile {
+  int width{0}, height{0};
+  int x0{0}, y0{0}, x1{0}, y1{0};
+  uint64_t config{0};
+  std::vector<float> rgb;
+  std::vector<uint32_t> spp;
+};
+
+/**
+ * @brief Read an integer from a buffer, little endian
+ *
+ * @tparam U Unsigned integer type
+ * @param p Bytes
+ * @return U Value
+ */
+template <typename U>
+U get_le(const char* p) {
+  U v = 0;
+  for (size_t k = 0; k < sizeof(U); k++)
+    v |= static_cast<U>(static_cast<unsigned char>(p[k])) << (8 * k);
+  return v;
+}
+
+/**
+ * @brief Write a tile
+ *
+ * @param out Binary ostream to write to
+ * @param t Tile
+ * @return true The tile was written
+ * @return false The stream failed
+ */
+inline bool write_tile(std::ostream& out, const image_tile& t) {
+  std::string buf;
+  put_le<uint32_t>(buf, 0x4c495452);  // "RTIL"
+  put_le<uint32_t>(buf, 1);           // version
+  for (const int v : {t.width, t.height, t.x0, t.y0, t.x1, t.y1})
+    put_le<uint32_t>(buf, static_cast<uint32_t>(v));
+  put_le<uint64_t>(buf, t.config);
+  buf.reserve(buf.size() + t.rgb.size() * 4 + t.spp.size() * 4);
+  for (const float& f : t.rgb)
+    put_le(buf, f);
+  for (const uint32_t& n : t.spp)
+    put_le<uint32_t>(buf, n);
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  return static_cast<bool>(out);
+}
+
+/**
+ * @brief Read a tile written by write_tile
+ *
+ * @param in Binary istream to read from
+ * @param t Tile read
+ * @return true The tile was read and its window lies in its image
+ * @return false The stream failed or holds no tile
+ */
+inline bool read_tile(std::istream& in, image_tile& t) {
+  const std::string buf{std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>()};
+  constexpr size_t head = 4 * 8 + 8;
+  if (buf.size() < head || get_le<uint32_t>(buf.data()) != 0x4c495452 ||
+      get_le<uint32_t>(buf.data() + 4) != 1)
+    return false;
+  int v[6];
+  for (int k = 0; k < 6; k++)
+    v[k] = static_cast<int>(get_le<uint32_t>(buf.data() + 8 + 4 * k));
+  t.width = v[0];
+  t.height = v[1];
+  t.x0 = v[2];
+  t.y0 = v[3];
+  t.x1 = v[4];
+  t.y1 = v[5];
+  t.config = get_le<uint64_t>(buf.data() + 32);
+  if (t.x0 < 0 || t.y0 < 0 || t.x0 >= t.x1 || t.y0 >= t.y1 ||
+      t.x1 > t.width || t.y1 > t.height)
+    return false;
+  const size_t n = static_cast<size_t>(t.x1 - t.x0) * (t.y1 - t.y0);
+  if (buf.size() != head + n * 16)
+    return false;
+  t.rgb.resize(n * 3);
+  t.spp.resize(n);
+  const char* p = buf.data() + head;
+  for (float& f : t.rgb) {
+    const uint32_t x = get_le<uint32_t>(p);
+    std::memcpy(&f, &x, sizeof(f));
+    p += 4;
+  }
+  for (uint32_t& s : t.spp) {
+    s = get_le<uint32_t>(p);
+    p += 4;
+  }
+  return true;
+}
+
+/**
+ * @brief Write a tile to a file, in place of any older one only once it is
+ * complete
+ *
+ * @param path File to write
+ * @param t Tile
+ * @param tmp_name Temporary file to write first, path with .tmp when empty
+ * @return true The tile is in place
+ * @return false It couldn't be written
+ */
+inline bool save_tile(const std::string& path,
+                      const image_tile& t,
+                      const std::string& tmp_name = std::string()) {
+  const std::string tmp = tmp_name.empty() ? path + ".tmp" : tmp_name;
+  std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+  if (!out || !write_tile(out, t))
+    return false;
+  // Checked once closed, see save_image
+  out.close();
+  if (!out) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @brief Read a tile from a file
+ *
+ * @param path File to read
+ * @param t Tile read
+ * @return true The file holds a tile
+ * @return false It couldn't be read or holds no tile
+ */
+inline bool load_tile(const std::string& path, image_tile& t) {
+  std::ifstream in(path, std::ios::binary);
+  return in && read_tile(in, t);
+}
+
+/**
+ * @brief Put tiles of one image back together
+ *
+ * @param tiles Tiles, of the same image and settings
+ * @param img Image put together
+ * @param err What is wrong, when the tiles don't make an image
+ * @return true Every pixel of the image is covered
+ * @return false The tiles are of different images or leave a hole
+ */
+inline bool merge_tiles(const std::vector<image_tile>& tiles,
+                        hdr_image& img,
+                        std::string& err) {
+  if (tiles.empty()) {
+    err = "no tiles";
+    return false;
+  }
+  const image_tile& first = tiles.front();
+  img.width = first.width;
+  img.height = first.height;
+  img.rgb.assign(static_cast<size_t>(img.width) * img.height * 3, 0.0f);
+  std::vector<bool> covered(static_cast<size_t>(img.width) * img.height);
+  for (const image_tile& t : tiles) {
+    if (t.width != first.width || t.height != first.height ||
+        t.config != first.config) {
+      err = "tiles of different images or settings";
+      return false;
+    }
+    const int w = t.x1 - t.x0;
+    for (int y = t.y0; y < t.y1; y++)
+      for (int x = t.x0; x < t.x1; x++) {
+        const size_t src = static_cast<size_t>(y - t.y0) * w + (x - t.x0);
+        const size_t dst = static_cast<size_t>(y) * img.width + x;
+        std::memcpy(&img.rgb[dst * 3], &t.rgb[src * 3], 3 * sizeof(float));
+        covered[dst] = true;
+      }
+  }
+  for (size_t k = 0; k < covered.size(); k++)
+    if (!covered[k]) {
+      err = "no tile covers pixel " + std::to_string(k % img.width) + "," +
+            std::to_string(k / img.width);
+      return false;
+    }
+  return true;
+}
@@ -28,14 +28,17 @@ class diffuse : public material<T> {
    *
    * @param c Color of object
    */
-  explicit diffuse(const color<T>& c)
-      : diff_col(std::make_shared<solid<T>>(c)) {}
+  explicit diffuse(const color<T>& c) : col_(c), diff_col(&col_) {}
   /**
    * @brief Construct a new diffuse object using a texture
    *
    * @param c Texture of object
    */
-  explicit diffuse(std::shared_ptr<uvTex<T>> c) : diff_col(c) {}
+  explicit diffuse(const uvTex<T>* c) : diff_col(c) {}
+
+  // A plain colour points the texture at the material's own solid
+  diffuse(const diffuse&) = delete;
+  diffuse& operator=(const diffuse&) = delete;
 
   // Override our scatter func
   /**
@@ -46,15 +49,41 @@ class diffuse : public material<T> {
    * @param rec Hit record of ray
    * @param att Attenuation
    * @param scat Scattering color
+   * @param g Engine of the path
    * @return true This object always scatters (always occurs)
    * @return false This object always scatters (never occurs)
    */
   bool scatter(const ray<T>& r,
                const hit_rec<T>& rec,
                color<T>& att,
-               ray<T>& scat) const override {
+               ray<T>& scat,
+               rng& g) const override {
+    return scatter_at(r, rec, att, scat, static_cast<T>(random_double(g)),
+                      static_cast<T>(random_double(g)), g);
+  }
+
+  /**
+   * @brief Scatter about the normal, with the offset on the unit sphere
+   * picked by a point of the unit square
+   *
+   * @param r Ray to compute
+   * @param rec Hit record of ray
+   * @param att Attenuation
+   * @param scat Scattering color
+   * @param a First coordinate of the point
+   * @param b Second coordinate of the point
+   * @return true This object always scatters (always occurs)
+   * @return false This object always scatters (never occurs)
+   */
+  bool scatter_at(const ray<T>& r,
+                  const hit_rec<T>& rec,
+                  color<T>& att,
+                  ray<T>& scat,
+                  const T& a,
+                  const T& b,
+                  rng&) const override {
     // We want to randomly scatter
-    vec3<T> scat_dir = rec.n + random_unit_v<T>();
+    vec3<T> scat_dir = rec.n + sphere_point(a, b);
 
     // Get redundant scatters
     if (scat_dir.near_null())
@@ -67,6 +96,44 @@ class diffuse : public material<T> {
     return true;
   }
 
+  /**
+   * @brief Diffuse surfaces can be light sampled
+   *
+   * @return false Never a delta material
+   */
+  bool is_delta() const override { return false; }
+
+  /**
+   * @brief Lambertian scattering towards a direction
+   *
+   * @param rec Hit record of ray
+   * @param dir Unit direction towards the light
+   * @return color<T> Albedo over pi, times the cosine to the normal
+   */
+  color<T> eval(const ray<T>&,
+                const hit_rec<T>& rec,
+                const vec3<T>& dir) const override {
+    const T cos = dot(rec.n, dir);
+    if (cos <= 0)
+      return color<T>(0, 0, 0);
+    return diff_col->val(rec.u, rec.v, rec.p) * static_cast<T>(cos / M_PI);
+  }
+
+  /**
+   * @brief Density of the cosine weighted directions scatter draws
+   *
+   * @param rec Hit record of ray
+   * @param dir Unit direction
+   * @return T Cosine to the normal over pi
+   */
+  T pdf(const ray<T>&,
+        const hit_rec<T>& rec,
+        const vec3<T>& dir) const override {
+    const T cos = dot(rec.n, dir);
+    return cos > 0 ? static_cast<T>(cos / M_PI) : 0;
+  }
+
  private:
-  std::shared_ptr<uvTex<T>> diff_col;
+  solid<T> col_;
+  const uvTex<T>* diff_col{nullptr};
 };
@@ -31,14 +31,17 @@ class diffuse_light : public material<T> {
    *
    * @param c Color of light
    */
-  explicit diffuse_light(const color<T>& c)
-      : c_(std::make_shared<solid<T>>(c)) {}
+  explicit diffuse_light(const color<T>& c) : col_(c), c_(&col_) {}
   /**
    * @brief Construct a new diffuse light object from a texture
    *
    * @param c Texture of light
    */
-  explicit diffuse_light(std::shared_ptr<uvTex<T>> c) : c_(c) {}
+  explicit diffuse_light(const uvTex<T>* c) : c_(c) {}
+
+  // A plain colour points the texture at the light's own solid
+  diffuse_light(const diffuse_light&) = delete;
+  diffuse_light& operator=(const diffuse_light&) = delete;
 
   // We won't be scattering this time
   /**
@@ -50,7 +53,8 @@ class diffuse_light : public material<T> {
   bool scatter(const ray<T>&,
                const hit_rec<T>&,
                color<T>&,
-               ray<T>&) const override {
+               ray<T>&,
+               rng&) const override {
     return false;
   }
 
@@ -66,10 +70,22 @@ class diffuse_light : public material<T> {
     return c_->val(u, v, p);
   }
 
+  /**
+   * @brief Diffuse lights are emitters
+   *
+   * @return true Always
+   */
+  bool emits() const override { return true; }
+
   //  private:
+  /**
+   * @brief Colour of the light when made from one
+   *
+   */
+  solid<T> col_;
   /**
    * @brief Texture of diffuse light
    *
    */
-  std::shared_ptr<uvTex<T>> c_;
+  const uvTex<T>* c_{nullptr};
 };
@@ -37,13 +37,15 @@ class glass : public material<T> {
    * @param rec Hit record of ray
    * @param att Attenuation
    * @param scat Scattering color
+   * @param g Engine of the path
    * @return true This object always scatters (always occurs)
    * @return false This object always scatters (never occurs)
    */
   bool scatter(const ray<T>& r,
                const hit_rec<T>& rec,
                color<T>& att,
-               ray<T>& scat) const override {
+               ray<T>& scat,
+               rng& g) const override {
     // Get the effective eta
     T refr_rat = rec.front ? (1.0 / eta_) : eta_;
 
@@ -58,7 +60,7 @@ class glass : public material<T> {
     vec3<T> direction;
 
     // If internal reflect, else refract
-    if (refl || (schlick(cos_t, refr_rat) > random_double()))
+    if (refl || (schlick(cos_t, refr_rat) > random_double(g)))
       direction = reflect<T>(unit_d, rec.n);
     else
       direction = refract<T>(unit_d, rec.n, refr_rat);
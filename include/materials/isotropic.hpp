@@ -25,13 +25,17 @@ class isotropic : public material<T> {
    * @brief Construct a new isotropic object from a texture
    *
    */
-  explicit isotropic(std::shared_ptr<uvTex<T>>(c)) : c_(c) {}
+  explicit isotropic(const uvTex<T>* c) : c_(c) {}
   /**
    * @brief Construct a new isotropic object from a color
    *
    * @param c Color of object
    */
-  explicit isotropic(const color<T>& c) : c_(std::make_shared<solid<T>>(c)) {}
+  explicit isotropic(const color<T>& c) : col_(c), c_(&col_) {}
+
+  // A plain colour points the texture at the material's own solid
+  isotropic(const isotropic&) = delete;
+  isotropic& operator=(const isotropic&) = delete;
 
   /**
    * @brief Overidden scatter function.
@@ -41,22 +45,81 @@ class isotropic : public material<T> {
    * @param rec Hit record of ray
    * @param att Attenuation
    * @param scat Scattering color
+   * @param g Engine of the path
    * @return true This object always scatters (always occurs)
    * @return false This object always scatters (never occurs)
    */
   bool scatter(const ray<T>& r,
                const hit_rec<T>& rec,
                color<T>& att,
-               ray<T>& scat) const override {
-    scat = ray<T>(rec.p, random_sphere<T>(), r.time());
+               ray<T>& scat,
+               rng& g) const override {
+    return scatter_at(r, rec, att, scat, static_cast<T>(random_double(g)),
+                      static_cast<T>(random_double(g)), g);
+  }
+
+  /**
+   * @brief Scatter into the direction of the unit sphere picked by a point
+   * of the unit square
+   *
+   * @param r Ray to compute
+   * @param rec Hit record of ray
+   * @param att Attenuation
+   * @param scat Scattering color
+   * @param a First coordinate of the point
+   * @param b Second coordinate of the point
+   * @return true This object always scatters (always occurs)
+   * @return false This object always scatters (never occurs)
+   */
+  bool scatter_at(const ray<T>& r,
+                  const hit_rec<T>& rec,
+                  color<T>& att,
+                  ray<T>& scat,
+                  const T& a,
+                  const T& b,
+                  rng&) const override {
+    scat = ray<T>(rec.p, sphere_point(a, b), r.time());
     att = c_->val(rec.u, rec.v, rec.p);
     return true;
   }
 
+  /**
+   * @brief Fog can be light sampled
+   *
+   * @return false Never a delta material
+   */
+  bool is_delta() const override { return false; }
+
+  /**
+   * @brief Isotropic phase function, the same in every direction
+   *
+   * @param rec Hit record of ray
+   * @return color<T> Fog color over the 4 pi of the sphere
+   */
+  color<T> eval(const ray<T>&,
+                const hit_rec<T>& rec,
+                const vec3<T>&) const override {
+    return c_->val(rec.u, rec.v, rec.p) * static_cast<T>(0.25 / M_PI);
+  }
+
+  /**
+   * @brief Density of the uniform directions scatter draws
+   *
+   * @return T One over the 4 pi of the sphere
+   */
+  T pdf(const ray<T>&, const hit_rec<T>&, const vec3<T>&) const override {
+    return static_cast<T>(0.25 / M_PI);
+  }
+
  private:
+  /**
+   * @brief Colour of the fog when made from one
+   *
+   */
+  solid<T> col_;
   /**
    * @brief Texture of fog
    *
    */
-  std::shared_ptr<uvTex<T>> c_;
+  const uvTex<T>* c_{nullptr};
 };
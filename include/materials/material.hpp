@@ -26,6 +26,8 @@ class material {
  public:
   /**
    * @brief Boolean for whether our object scatters or absorbs
+   * @details Every random number is drawn from the engine passed in, which
+   * belongs to the path being traced.
    *
    * @return true If true, the object scatters
    * @return false If false, the object absorbs
@@ -33,7 +35,36 @@ class material {
   virtual bool scatter(const ray<T>&,
                        const hit_rec<T>&,
                        color<T>&,
-                       ray<T>&) const = 0;
+                       ray<T>&,
+                       rng&) const = 0;
+
+  /**
+   * @brief Scatter into a direction picked by a point of the unit square
+   * @details Materials that pick their direction from two numbers override
+   * this, so the numbers can come from the sampler of the path. By default
+   * the point is ignored and scatter draws from the engine.
+   *
+   * @param r Ray to compute
+   * @param rec Hit record of ray
+   * @param att Attenuation
+   * @param scat Scattered ray
+   * @param a First coordinate of the point
+   * @param b Second coordinate of the point
+   * @param g Engine of the path
+   * @return true The ray scatters
+   * @return false The ray is absorbed
+   */
+  virtual bool scatter_at(const ray<T>& r,
+                          const hit_rec<T>& rec,
+                          color<T>& att,
+                          ray<T>& scat,
+                          const T& a,
+                          const T& b,
+                          rng& g) const {
+    (void)a;
+    (void)b;
+    return scatter(r, rec, att, scat, g);
+  }
 
   // Function for emission behaviour of light
   /**
@@ -44,4 +75,73 @@ class material {
   virtual color<T> emit(const T&, const T&, const point3<T>&) const {
     return color<T>(0, 0, 0);
   }
+
+  /**
+   * @brief Whether the material emits light
+   *
+   * @return true The material is a light, emit may be non zero
+   * @return false The material never emits
+   */
+  virtual bool emits() const { return false; }
+
+  /**
+   * @brief Whether light sampling must skip the material
+   * @details True for materials that scatter into a single direction
+   * (mirrors, glass) and for any material that doesn't override eval.
+   *
+   * @return true eval can't be used, light is only found by scattering
+   * @return false eval gives the scattering towards any direction
+   */
+  virtual bool is_delta() const { return true; }
+
+  /**
+   * @brief Attenuation of light arriving from a direction, per unit solid
+   * angle and cosine weighted where the material needs it
+   *
+   * @return color<T> Scattered fraction, default to none
+   */
+  virtual color<T> eval(const ray<T>&,
+                        const hit_rec<T>&,
+                        const vec3<T>&) const {
+    return color<T>(0, 0, 0);
+  }
+
+  /**
+   * @brief Density with which scatter picks a direction
+   * @details eval over pdf must equal the attenuation scatter returns for
+   * that direction, so light and scatter sampling can be weighed together.
+   *
+   * @return T Density per unit solid angle, default to none
+   */
+  virtual T pdf(const ray<T>&, const hit_rec<T>&, const vec3<T>&) const {
+    return 0;
+  }
+
+  /**
+   * @brief Scatter, and also return the density of the chosen direction
+   *
+   * @param r Ray to compute
+   * @param rec Hit record of ray
+   * @param att Attenuation, eval over pdf
+   * @param scat Scattered ray
+   * @param pdf Density of the scattered direction, 0 for delta materials
+   * @param a First coordinate of a point of the unit square for scatter_at
+   * @param b Second coordinate of the point
+   * @param g Engine of the path
+   * @return true The ray scatters
+   * @return false The ray is absorbed
+   */
+  bool sample(const ray<T>& r,
+              const hit_rec<T>& rec,
+              color<T>& att,
+              ray<T>& scat,
+              T& pdf,
+              const T& a,
+              const T& b,
+              rng& g) const {
+    if (!scatter_at(r, rec, att, scat, a, b, g))
+      return false;
+    pdf = is_delta() ? 0 : this->pdf(r, rec, unit_v(scat.direction()));
+    return true;
+  }
 };
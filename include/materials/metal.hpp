@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+
 #include "material.hpp"
 
 // Make a public subclass of material
@@ -39,21 +42,76 @@ class metal : public material<T> {
    * @param rec Hit record of ray
    * @param att Attenuation
    * @param scat Scattering color
+   * @param g Engine of the path
    * @return true This object always scatters (always occurs)
    * @return false This object always scatters (never occurs)
    */
   bool scatter(const ray<T>& r,
                const hit_rec<T>& rec,
                color<T>& att,
-               ray<T>& scat) const override {
+               ray<T>& scat,
+               rng& g) const override {
     // Reflect the ray around normal
     vec3<T> ref = reflect<T>(unit_v<T>(r.direction()), rec.n);
     // Add a fuzz-factor to our metal
-    scat = ray<T>(rec.p, ref + fuzz_ * random_sphere<T>()), r.time();
+    scat = ray<T>(rec.p, ref + fuzz_ * random_sphere<T>(g), r.time());
     att = metal_col;
     return true;
   }
 
+  /**
+   * @brief Only a perfect mirror is a delta material
+   *
+   * @return true The metal has no fuzz
+   * @return false Fuzzy metal spreads light over a lobe
+   */
+  bool is_delta() const override { return !(fuzz_ > 0); }
+
+  /**
+   * @brief Attenuation towards a direction of the fuzzy lobe
+   *
+   * @param r Ray to compute
+   * @param rec Hit record of ray
+   * @param dir Unit direction
+   * @return color<T> Metal color times the density of the lobe
+   */
+  color<T> eval(const ray<T>& r,
+                const hit_rec<T>& rec,
+                const vec3<T>& dir) const override {
+    return metal_col * pdf(r, rec, dir);
+  }
+
+  /**
+   * @brief Density of the directions scatter draws
+   * @details scatter offsets the mirror direction by a point drawn uniformly
+   * in a ball of radius fuzz. Along dir that ball is crossed between t0 and
+   * t1, which holds (t1^3 - t0^3) / 3 of the ball's volume per unit solid
+   * angle.
+   *
+   * @param r Ray to compute
+   * @param rec Hit record of ray
+   * @param dir Unit direction
+   * @return T Density per unit solid angle
+   */
+  T pdf(const ray<T>& r,
+        const hit_rec<T>& rec,
+        const vec3<T>& dir) const override {
+    if (!(fuzz_ > 0))
+      return 0;
+    const vec3<T> ref = reflect<T>(unit_v<T>(r.direction()), rec.n);
+    const T b = dot(dir, ref);
+    const T disc = b * b - ref.norm_sqr() + fuzz_ * fuzz_;
+    if (disc <= 0)
+      return 0;
+    const T s = std::sqrt(disc);
+    const T t1 = b + s;
+    if (t1 <= 0)
+      return 0;
+    const T t0 = std::max(b - s, static_cast<T>(0));
+    const T f3 = fuzz_ * fuzz_ * fuzz_;
+    return (t1 * t1 * t1 - t0 * t0 * t0) / static_cast<T>(4 * M_PI * f3);
+  }
+
  private:
   // TODO: This should be a texture
   /**
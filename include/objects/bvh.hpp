@@ -11,7 +11,212 @@
 #pragma once
 
 #include <algorithm>
+#include "arena.hpp"
 #include "bounding_box.hpp"
+#include "hit_list.hpp"
+
+/**
+ * @brief Strategy used to split a BVH node
+ *
+ */
+enum class bvh_split {
+  /**
+   * @brief Sort on a random axis and split at the median object
+   *
+   */
+  median,
+  /**
+   * @brief Binned surface area heuristic on the widest centroid axis
+   *
+   */
+  sah
+};
+
+/**
+ * @brief Settings for building a BVH
+ *
+ */
+struct bvh_options {
+  /**
+   * @brief Split strategy
+   *
+   */
+  bvh_split split = bvh_split::sah;
+  /**
+   * @brief Number of SAH bins along the split axis
+   *
+   */
+  int bins = 16;
+  /**
+   * @brief Largest number of objects the SAH builder may leave in a leaf
+   *
+   */
+  size_t leaf_size = 4;
+  /**
+   * @brief Relative cost of visiting a node
+   *
+   */
+  double traversal_cost = 1.0;
+  /**
+   * @brief Relative cost of intersecting an object
+   *
+   */
+  double intersect_cost = 1.0;
+  /**
+   * @brief Number of objects a leaf intersects at once (e.g SIMD lanes)
+   *
+   */
+  size_t batch = 1;
+};
+
+/**
+ * @brief Cost of intersecting n objects in a leaf
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param n Number of objects
+ * @param opt Build options
+ * @return T Cost, counting every started batch in full
+ */
+template <typename T>
+inline T leaf_cost(const size_t& n, const bvh_options& opt) {
+  const size_t b = std::max<size_t>(1, opt.batch);
+  return static_cast<T>(opt.intersect_cost) * ((n + b - 1) / b);
+}
+
+/**
+ * @brief Options used by bvh nodes built without explicit options
+ * @details main sets this from the config so the scenes need not know about
+ * it.
+ *
+ * @return bvh_options& Default options
+ */
+inline bvh_options& bvh_defaults() {
+  static bvh_options opt;
+  return opt;
+}
+
+/**
+ * @brief An object's bounding box and centroid, as seen by the builder
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct bvh_prim {
+  BB<T> box;
+  point3<T> c;
+  size_t id;
+};
+
+/**
+ * @brief Return a box that contains nothing, the identity of surround_box
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @return BB<T> Empty bounding box
+ */
+template <typename T>
+inline BB<T> empty_box() {
+  return BB<T>(point3<T>(inf<T>), point3<T>(-inf<T>));
+}
+
+/**
+ * @brief Partition objects [start,end) with the binned surface area heuristic
+ * @details The centroids are dropped into bins along their widest axis and
+ * every bin boundary is scored with
+ * cost = traversal + (A_L N_L + A_R N_R) / A * intersect.
+ * The cheapest split is compared with the cost of making a leaf.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param p Objects to partition, reordered in place
+ * @param start First object
+ * @param end One past the last object
+ * @param opt Build options
+ * @return size_t First object of the right child, or start to make a leaf
+ */
+template <typename T>
+size_t sah_partition(std::vector<bvh_prim<T>>& p,
+                     const size_t& start,
+                     const size_t& end,
+                     const bvh_options& opt) {
+  const size_t n = end - start;
+  if (n <= 1)
+    return start;
+
+  BB<T> bounds = empty_box<T>();
+  BB<T> cbounds = empty_box<T>();
+  for (size_t i = start; i < end; i++) {
+    bounds = surround_box(bounds, p[i].box);
+    cbounds = surround_box(cbounds, BB<T>(p[i].c, p[i].c));
+  }
+
+  const int axis = cbounds.axis();
+  const T lo = cbounds.min()[axis];
+  const T extent = cbounds.max()[axis] - lo;
+
+  // Every centroid in one spot, bins can't separate them
+  if (!(extent > 0)) {
+    if (n <= opt.leaf_size)
+      return start;
+    return start + n / 2;
+  }
+
+  const int nb = std::max(2, opt.bins);
+  std::vector<BB<T>> bin_box(nb, empty_box<T>());
+  std::vector<size_t> bin_n(nb, 0);
+  auto bin_of = [&](const bvh_prim<T>& q) {
+    int b = static_cast<int>(nb * ((q.c[axis] - lo) / extent));
+    return std::min(nb - 1, std::max(0, b));
+  };
+
+  for (size_t i = start; i < end; i++) {
+    int b = bin_of(p[i]);
+    bin_n[b]++;
+    bin_box[b] = surround_box(bin_box[b], p[i].box);
+  }
+
+  // Sweep from the right to get the area and count right of each boundary
+  std::vector<T> right_area(nb, 0);
+  std::vector<size_t> right_n(nb, 0);
+  BB<T> acc = empty_box<T>();
+  size_t cnt = 0;
+  for (int b = nb - 1; b > 0; b--) {
+    acc = surround_box(acc, bin_box[b]);
+    cnt += bin_n[b];
+    right_area[b] = cnt ? acc.area() : 0;
+    right_n[b] = cnt;
+  }
+
+  // Then sweep from the left, scoring the boundary after bin b
+  const T inv_area = static_cast<T>(1) / bounds.area();
+  T best_cost = inf<T>;
+  int best = -1;
+  acc = empty_box<T>();
+  cnt = 0;
+  for (int b = 0; b < nb - 1; b++) {
+    acc = surround_box(acc, bin_box[b]);
+    cnt += bin_n[b];
+    if (cnt == 0 || right_n[b + 1] == 0)
+      continue;
+    T cost = static_cast<T>(opt.traversal_cost) +
+             inv_area * (acc.area() * leaf_cost<T>(cnt, opt) +
+                         right_area[b + 1] * leaf_cost<T>(right_n[b + 1], opt));
+    if (cost < best_cost) {
+      best_cost = cost;
+      best = b;
+    }
+  }
+
+  if (n <= opt.leaf_size && leaf_cost<T>(n, opt) <= best_cost)
+    return start;
+
+  if (best < 0)
+    return start + n / 2;
+
+  auto mid = std::partition(p.begin() + start, p.begin() + end,
+                            [&](const bvh_prim<T>& q) {
+                              return bin_of(q) <= best;
+                            });
+  return static_cast<size_t>(mid - p.begin());
+}
 
 /**
  * @brief BVH Node class, these nodes recurse to build a tree
@@ -32,18 +237,24 @@ class bvh_node : public hit<T> {
    * @param l Hit list
    * @param t0 Initial shutter time
    * @param t1 Final shutter time
+   * @param mem Arena the inner nodes and leaf lists are placed in
+   * @param opt Build options
    */
-  bvh_node(const hit_list<T>& l, const T& t0, const T& t1)
-      : bvh_node(l.objects(), 0, l.size(), t0, t1) {}
+  bvh_node(const hit_list<T>& l,
+           const T& t0,
+           const T& t1,
+           arena& mem,
+           const bvh_options& opt = bvh_defaults());
   /**
-   * @brief Construct a new bvh node object
+   * @brief Construct a new bvh node object with the median builder
    *
    */
-  bvh_node(const std::vector<std::shared_ptr<hit<T>>>&,
+  bvh_node(const std::vector<const hit<T>*>&,
            const size_t&,
            const size_t&,
            const T&,
-           const T&);
+           const T&,
+           arena&);
 
   /**
    * @brief Whether we are in the bounding box
@@ -57,45 +268,122 @@ class bvh_node : public hit<T> {
     return true;
   }
 
+  /**
+   * @brief Return the deepest nesting of transform wrappers in the tree
+   *
+   * @return int Wrapper depth of the deepest object
+   */
+  int wrap_depth() const override {
+    return std::max(left_ ? left_->wrap_depth() : 0,
+                    right_ ? right_->wrap_depth() : 0);
+  }
+
   /**
    * @brief Compute whether ray intersects the BVH tree
    *
    * @param r Ray to compute
    * @param t_min Initial shutter time
    * @param t_max Final shutter time
-   * @param rec Hit record of ray
+   * @param is Closest hit so far
    * @return true True if object is hit
    * @return false False if object is not hit
    */
-  bool is_hit(const ray<T>& r,
-              const T& t_min,
-              const T& t_max,
-              hit_rec<T>& rec) const override {
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override {
     if (!box.is_hit(r, t_min, t_max))
       return false;
 
-    bool hit_l = left_->is_hit(r, t_min, t_max, rec);
-    bool hit_r = right_->is_hit(r, t_min, hit_l ? rec.t : t_max, rec);
+    bool hit_l = left_->intersect(r, t_min, t_max, is);
+    // Leaves keep all their objects on the left
+    if (!right_)
+      return hit_l;
+    bool hit_r = right_->intersect(r, t_min, hit_l ? is.t : t_max, is);
 
     return hit_l || hit_r;
   }
 
+  /**
+   * @brief Whether anything in the tree blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True as soon as one object is hit
+   * @return false False if no object is hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    if (!box.is_hit(r, t_min, t_max))
+      return false;
+    if (left_->occluded(r, t_min, t_max))
+      return true;
+    return right_ && right_->occluded(r, t_min, t_max);
+  }
+
+  /**
+   * @brief Return the expected cost of tracing a ray through this node
+   * @details Surface area heuristic estimate of the tree, in units of the
+   * costs in bvh_options. Lower is better; use it to compare builders.
+   *
+   * @return T Expected cost of the subtree
+   */
+  T cost() const { return cost_; }
+
+  /**
+   * @brief Return the left child, the only child of a leaf
+   *
+   * @return const hit<T>* Left child
+   */
+  const hit<T>* left() const { return left_; }
+  /**
+   * @brief Return the right child, empty for a leaf
+   *
+   * @return const hit<T>* Right child
+   */
+  const hit<T>* right() const { return right_; }
+
  private:
+  /**
+   * @brief Build the subtree over objects [start,end) with the SAH builder
+   *
+   */
+  void build_sah(const std::vector<const hit<T>*>&,
+                 std::vector<bvh_prim<T>>&,
+                 const size_t&,
+                 const size_t&,
+                 const T&,
+                 const T&,
+                 arena&,
+                 const bvh_options&);
+  /**
+   * @brief Fill in the box and cost once the children are set
+   *
+   */
+  void finish(const T&, const T&, const bvh_options&);
+
   /**
    * @brief Left boundary of BVH
    *
    */
-  std::shared_ptr<hit<T>> left_;
+  const hit<T>* left_{nullptr};
   /**
    * @brief Right boundary of BVH
    *
    */
-  std::shared_ptr<hit<T>> right_;
+  const hit<T>* right_{nullptr};
   /**
    * @brief Bounding box of the BVH tree
    *
    */
   BB<T> box;
+  /**
+   * @brief Expected cost of the subtree
+   *
+   */
+  T cost_{0};
 };
 
 /**
@@ -109,8 +397,8 @@ class bvh_node : public hit<T> {
  * @return false False if a > b
  */
 template <typename T>
-inline bool comp(const std::shared_ptr<hit<T>> a,
-                 const std::shared_ptr<hit<T>> b,
+inline bool comp(const hit<T>* a,
+                 const hit<T>* b,
                  const int& axis) {
   BB<T> b1;
   BB<T> b2;
@@ -136,7 +424,7 @@ inline bool comp(const std::shared_ptr<hit<T>> a,
  * @return false False if a > b
  */
 template <typename T>
-bool x_comp(const std::shared_ptr<hit<T>> a, const std::shared_ptr<hit<T>> b) {
+bool x_comp(const hit<T>* a, const hit<T>* b) {
   return comp(a, b, 0);
 }
 
@@ -150,7 +438,7 @@ bool x_comp(const std::shared_ptr<hit<T>> a, const std::shared_ptr<hit<T>> b) {
  * @return false False if a > b
  */
 template <typename T>
-bool y_comp(const std::shared_ptr<hit<T>> a, const std::shared_ptr<hit<T>> b) {
+bool y_comp(const hit<T>* a, const hit<T>* b) {
   return comp(a, b, 1);
 }
 
@@ -164,12 +452,138 @@ bool y_comp(const std::shared_ptr<hit<T>> a, const std::shared_ptr<hit<T>> b) {
  * @return false False if a > b
  */
 template <typename T>
-bool z_comp(const std::shared_ptr<hit<T>> a, const std::shared_ptr<hit<T>> b) {
+bool z_comp(const hit<T>* a, const hit<T>* b) {
   return comp(a, b, 2);
 }
 
 /**
- * @brief Construct a new bvh node<T>::bvh node object
+ * @brief Return the expected cost of a child of a bvh node
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param h Child object
+ * @param opt Build options
+ * @return T Expected cost of the child
+ */
+template <typename T>
+inline T child_cost(const hit<T>* h, const bvh_options& opt) {
+  if (auto node = dynamic_cast<const bvh_node<T>*>(h))
+    return node->cost();
+  if (auto list = dynamic_cast<const hit_list<T>*>(h))
+    return static_cast<T>(opt.intersect_cost) * list->size();
+  return static_cast<T>(opt.intersect_cost);
+}
+
+/**
+ * @brief Fill in the box and SAH cost once the children are set
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param t0 Initial shutter time
+ * @param t1 Final shutter time
+ * @param opt Build options
+ */
+template <typename T>
+void bvh_node<T>::finish(const T& t0, const T& t1, const bvh_options& opt) {
+  BB<T> bL, bR;
+
+  if (!left_->bound_box(t0, t1, bL) ||
+      (right_ && !right_->bound_box(t0, t1, bR)))
+    std::cerr << "No box in bvh_node constructor \n";
+  box = right_ ? surround_box(bL, bR) : bL;
+
+  // A leaf is tested in full, a split pays for a visit plus its children
+  // weighted by the chance a ray through us also passes through them
+  if (!right_) {
+    cost_ = child_cost(left_, opt);
+  } else {
+    T a = box.area();
+    T wl = a > 0 ? bL.area() / a : 1;
+    T wr = a > 0 ? bR.area() / a : 1;
+    cost_ = static_cast<T>(opt.traversal_cost) + wl * child_cost(left_, opt) +
+            wr * child_cost(right_, opt);
+  }
+}
+
+/**
+ * @brief Construct a new bvh node<T>::bvh node object from a hit list
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param l Hit list
+ * @param t0 Initial shutter time
+ * @param t1 Final shutter time
+ * @param mem Arena the inner nodes and leaf lists are placed in
+ * @param opt Build options
+ */
+template <typename T>
+bvh_node<T>::bvh_node(const hit_list<T>& l,
+                      const T& t0,
+                      const T& t1,
+                      arena& mem,
+                      const bvh_options& opt) {
+  const std::vector<const hit<T>*>& obj = l.objects();
+
+  if (opt.split == bvh_split::median) {
+    *this = bvh_node(obj, 0, obj.size(), t0, t1, mem);
+    return;
+  }
+
+  std::vector<bvh_prim<T>> prims(obj.size());
+  for (size_t i = 0; i < obj.size(); i++) {
+    if (!obj[i]->bound_box(t0, t1, prims[i].box))
+      std::cerr << "No box in bvh_node constructor \n";
+    prims[i].c =
+        static_cast<T>(0.5) * (prims[i].box.min() + prims[i].box.max());
+    prims[i].id = i;
+  }
+  build_sah(obj, prims, 0, prims.size(), t0, t1, mem, opt);
+}
+
+/**
+ * @brief Build the subtree over objects [start,end) with the SAH builder
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param obj Objects referenced by the build records
+ * @param prims Build records, reordered in place
+ * @param start First object
+ * @param end One past the last object
+ * @param t0 Initial shutter time
+ * @param t1 Final shutter time
+ * @param mem Arena the inner nodes and leaf lists are placed in
+ * @param opt Build options
+ */
+template <typename T>
+void bvh_node<T>::build_sah(const std::vector<const hit<T>*>& obj,
+                            std::vector<bvh_prim<T>>& prims,
+                            const size_t& start,
+                            const size_t& end,
+                            const T& t0,
+                            const T& t1,
+                            arena& mem,
+                            const bvh_options& opt) {
+  const size_t mid = sah_partition(prims, start, end, opt);
+
+  if (mid == start) {
+    if (end - start == 1) {
+      left_ = obj[prims[start].id];
+    } else {
+      hit_list<T>* leaf = mem.make<hit_list<T>>();
+      for (size_t i = start; i < end; i++)
+        leaf->add(obj[prims[i].id]);
+      left_ = leaf;
+    }
+  } else {
+    // Siblings are made together so they sit side by side in the arena
+    bvh_node<T>* l = mem.make<bvh_node<T>>();
+    bvh_node<T>* r = mem.make<bvh_node<T>>();
+    l->build_sah(obj, prims, start, mid, t0, t1, mem, opt);
+    r->build_sah(obj, prims, mid, end, t0, t1, mem, opt);
+    left_ = l;
+    right_ = r;
+  }
+  finish(t0, t1, opt);
+}
+
+/**
+ * @brief Construct a new bvh node<T>::bvh node object with the median builder
  *
  * @tparam T Datatype to be used (e.g float, double)
  * @param src Source hit list/vector of hits
@@ -177,15 +591,17 @@ bool z_comp(const std::shared_ptr<hit<T>> a, const std::shared_ptr<hit<T>> b) {
  * @param end Size of end iteration
  * @param t0 Initial shutter time
  * @param t1 Final shutter time
+ * @param mem Arena the inner nodes are placed in
  */
 template <typename T>
-bvh_node<T>::bvh_node(const std::vector<std::shared_ptr<hit<T>>>& src,
+bvh_node<T>::bvh_node(const std::vector<const hit<T>*>& src,
                       const size_t& start,
                       const size_t& end,
                       const T& t0,
-                      const T& t1) {
+                      const T& t1,
+                      arena& mem) {
   // Didn't want to put this code here but had errors implementing below
-  std::vector<std::shared_ptr<hit<T>>> obj = src;
+  std::vector<const hit<T>*> obj = src;
 
   int axis = random_int(0, 2);
 
@@ -207,13 +623,9 @@ bvh_node<T>::bvh_node(const std::vector<std::shared_ptr<hit<T>>>& src,
     std::sort(obj.begin() + start, obj.begin() + end, comparator);
 
     size_t mid = start + obj_len / 2;
-    left_ = std::make_shared<bvh_node<T>>(obj, start, mid, t0, t1);
-    right_ = std::make_shared<bvh_node<T>>(obj, mid, end, t0, t1);
+    left_ = mem.make<bvh_node<T>>(obj, start, mid, t0, t1, mem);
+    right_ = mem.make<bvh_node<T>>(obj, mid, end, t0, t1, mem);
   }
 
-  BB<T> bL, bR;
-
-  if (!left_->bound_box(t0, t1, bL) || !right_->bound_box(t0, t1, bR))
-    std::cerr << "No box in bvh_node constructor \n";
-  box = surround_box(bL, bR);
+  finish(t0, t1, bvh_defaults());
 }
@@ -0,0 +1,296 @@
+/**
+ * @file closed_bvh.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Flattened BVH over a closed set of primitive types
+ * @details The built-in primitives (spheres, moving spheres, rectangles and
+ * triangles) are copied by value into a std::variant, so the leaf loop knows
+ * the type of every primitive and calls its intersection directly, where the
+ * compiler can inline it. Cubes stay in the scene and are called through a
+ * typed pointer: one box in the tree culls all six sides, which beats
+ * placing the sides in the tree on their own. Anything else (meshes, fog,
+ * translations, rotations, user types) is kept as a pointer and reached
+ * through the virtual hit<T> interface as before.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <typeinfo>
+#include <variant>
+#include <vector>
+
+#include "cube.hpp"
+#include "linear_bvh.hpp"
+#include "moving_sphere.hpp"
+#include "rectangle.hpp"
+#include "sphere.hpp"
+#include "triangle.hpp"
+
+/**
+ * @brief One primitive of a closed world: a built-in type held by value, a
+ * cube held by the scene, or any other object through its hit<T> pointer
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+using closed_prim = std::variant<sphere<T>,
+                                 moving_sphere<T>,
+                                 xy_rectangle<T>,
+                                 xz_rectangle<T>,
+                                 yz_rectangle<T>,
+                                 triangle<T>,
+                                 const cube<T>*,
+                                 const hit<T>*>;
+
+/**
+ * @brief Hittable flat BVH whose leaves dispatch on a closed primitive set
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+class closed_bvh : public hit<T> {
+ public:
+  /**
+   * @brief Construct an uninitialized closed bvh object
+   *
+   */
+  closed_bvh() {}
+  /**
+   * @brief Construct a new closed bvh object over every object of a list
+   * @details bvh_node and hit_list objects are opened up, built-in
+   * primitives are copied into the tree and the rest are referred to.
+   *
+   * @param l Hit list
+   * @param t0 Initial shutter time
+   * @param t1 Final shutter time
+   * @param opt Build options
+   */
+  closed_bvh(const hit_list<T>& l,
+             const T& t0,
+             const T& t1,
+             const bvh_options& opt = bvh_defaults()) {
+    std::vector<closed_prim<T>> obj;
+    for (const hit<T>* o : l.objects())
+      gather(o, obj);
+
+    std::vector<bvh_prim<T>> prims(obj.size());
+    for (size_t i = 0; i < obj.size(); i++) {
+      bvh_prim<T>& p = prims[i];
+      if (!base(obj[i]).bound_box(t0, t1, p.box))
+        std::cerr << "No box in closed_bvh constructor \n";
+      p.c = static_cast<T>(0.5) * (p.box.min() + p.box.max());
+      p.id = i;
+    }
+    tree_.build(prims, opt);
+
+    // Primitives are referred to by address from here on, place them once
+    obj_.reserve(prims.size());
+    for (const auto& p : prims) {
+      obj_.push_back(std::move(obj[p.id]));
+      if (std::holds_alternative<const hit<T>*>(obj_.back()))
+        virtual_++;
+    }
+  }
+
+  // Hits point into the tree's own primitives
+  closed_bvh(const closed_bvh&) = delete;
+  closed_bvh& operator=(const closed_bvh&) = delete;
+
+  /**
+   * @brief Whether we are in the bounding box
+   *
+   * @param out Bounding box of the tree
+   * @return true True if the tree holds objects
+   * @return false False if the tree is empty
+   */
+  bool bound_box(const T&, const T&, BB<T>& out) const override {
+    if (tree_.empty())
+      return false;
+    out = tree_.bounds();
+    return true;
+  }
+
+  /**
+   * @brief Return the deepest nesting of transform wrappers in the tree
+   * @details Only objects referred to through hit<T> can be wrappers.
+   *
+   * @return int Wrapper depth of the deepest object
+   */
+  int wrap_depth() const override {
+    int depth = 0;
+    for (const closed_prim<T>& o : obj_)
+      if (const hit<T>* const* h = std::get_if<const hit<T>*>(&o))
+        depth = std::max(depth, (*h)->wrap_depth());
+    return depth;
+  }
+
+  /**
+   * @brief Compute whether ray intersects the tree
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @param is Closest hit so far
+   * @return true True if object is hit
+   * @return false False if object is not hit
+   */
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override {
+    T best = t_max;
+    return tree_.traverse(r, t_min, best, [&](uint32_t first, uint16_t count,
+                                               T& t_best) {
+      bool hit_ = false;
+      for (uint32_t k = first; k < first + count; k++) {
+        const bool h = std::visit(
+            [&](const auto& o) {
+              using P = std::decay_t<decltype(o)>;
+              // A qualified call skips the vtable so the body can be inlined
+              if constexpr (std::is_same<P, const cube<T>*>::value)
+                return o->cube<T>::intersect(r, t_min, t_best, is);
+              else if constexpr (std::is_pointer<P>::value)
+                return o->intersect(r, t_min, t_best, is);
+              else
+                return o.P::intersect(r, t_min, t_best, is);
+            },
+            obj_[k]);
+        if (h) {
+          hit_ = true;
+          t_best = is.t;
+        }
+      }
+      return hit_;
+    });
+  }
+
+  /**
+   * @brief Whether any primitive in the tree blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True as soon as one primitive is hit
+   * @return false False if no primitive is hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    return tree_.any(r, t_min, t_max, [&](uint32_t first, uint16_t count) {
+      isect<T> is;
+      for (uint32_t k = first; k < first + count; k++) {
+        const bool h = std::visit(
+            [&](const auto& o) {
+              using P = std::decay_t<decltype(o)>;
+              if constexpr (std::is_same<P, const cube<T>*>::value)
+                return o->cube<T>::occluded(r, t_min, t_max);
+              else if constexpr (std::is_pointer<P>::value)
+                return o->occluded(r, t_min, t_max);
+              else
+                return o.P::intersect(r, t_min, t_max, is);
+            },
+            obj_[k]);
+        if (h)
+          return true;
+      }
+      return false;
+    });
+  }
+
+  /**
+   * @brief Return the shape of the tree
+   *
+   * @return const bvh_stats& Build statistics
+   */
+  const bvh_stats& stats() const { return tree_.stats(); }
+
+  /**
+   * @brief Return the number of primitives in the tree
+   *
+   * @return size_t Primitives, inline and virtual
+   */
+  size_t size() const { return obj_.size(); }
+
+  /**
+   * @brief Return the number of primitives reached through hit<T>
+   *
+   * @return size_t Primitives outside the closed set
+   */
+  size_t virtual_size() const { return virtual_; }
+
+ private:
+  /**
+   * @brief View a primitive through its hit<T> interface
+   *
+   */
+  static const hit<T>& base(const closed_prim<T>& p) {
+    return std::visit(
+        [](const auto& o) -> const hit<T>& {
+          if constexpr (std::is_pointer<std::decay_t<decltype(o)>>::value)
+            return *o;
+          else
+            return o;
+        },
+        p);
+  }
+
+  /**
+   * @brief Collect the primitives of a list, opening up trees and lists
+   *
+   */
+  static void gather(const hit<T>* o, std::vector<closed_prim<T>>& out) {
+    if (auto node = dynamic_cast<const bvh_node<T>*>(o)) {
+      gather(node->left(), out);
+      if (node->right() && node->right() != node->left())
+        gather(node->right(), out);
+    } else if (auto list = dynamic_cast<const hit_list<T>*>(o)) {
+      for (const hit<T>* c : list->objects())
+        gather(c, out);
+    } else if (typeid(*o) == typeid(cube<T>)) {
+      out.push_back(static_cast<const cube<T>*>(o));
+    } else if (!(take<sphere<T>>(o, out) || take<moving_sphere<T>>(o, out) ||
+                 take<xy_rectangle<T>>(o, out) ||
+                 take<xz_rectangle<T>>(o, out) ||
+                 take<yz_rectangle<T>>(o, out) ||
+                 take<triangle<T>>(o, out))) {
+      out.push_back(o);
+    }
+  }
+
+  /**
+   * @brief Copy an object into the list if it is exactly of type P
+   * @details Types derived from a built-in primitive may override it, so
+   * they stay behind their pointer. So do emitters, hits on them must carry
+   * the address the light list knows them by.
+   *
+   */
+  template <typename P>
+  static bool take(const hit<T>* o, std::vector<closed_prim<T>>& out) {
+    if (typeid(*o) != typeid(P) || o->emitter())
+      return false;
+    out.push_back(static_cast<const P&>(*o));
+    return true;
+  }
+
+  /**
+   * @brief The flattened tree
+   *
+   */
+  flat_bvh<T> tree_;
+  /**
+   * @brief Primitives in leaf order
+   *
+   */
+  std::vector<closed_prim<T>> obj_;
+  /**
+   * @brief Number of primitives reached through hit<T>
+   *
+   */
+  size_t virtual_{0};
+};
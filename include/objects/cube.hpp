@@ -29,7 +29,7 @@ class cube : public hit<T> {
    * @brief Construct a new cube object
    *
    */
-  cube(const point3<T>&, const point3<T>&, std::shared_ptr<material<T>>);
+  cube(const point3<T>&, const point3<T>&, const material<T>*);
 
   /**
    * @brief Compute whether ray intersects the cube
@@ -37,15 +37,54 @@ class cube : public hit<T> {
    * @param r Ray to compute
    * @param t_min Initial shutter time
    * @param t_max Final shutter time
-   * @param rec Hit record of ray
+   * @param is Closest hit so far
    * @return true True if any of the sides are hit
    * @return false False if none of the sides are hit
    */
-  bool is_hit(const ray<T>& r,
-              const T& t_min,
-              const T& t_max,
-              hit_rec<T>& rec) const override {
-    return sides.is_hit(r, t_min, t_max, rec);
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override {
+    bool hit_ = false;
+    T best = t_max;
+    // The side types are known, qualified calls skip the vtable
+    for (int k = 0; k < 2; k++)
+      if (xy_[k].xy_rectangle<T>::intersect(r, t_min, best, is)) {
+        hit_ = true;
+        best = is.t;
+      }
+    for (int k = 0; k < 2; k++)
+      if (xz_[k].xz_rectangle<T>::intersect(r, t_min, best, is)) {
+        hit_ = true;
+        best = is.t;
+      }
+    for (int k = 0; k < 2; k++)
+      if (yz_[k].yz_rectangle<T>::intersect(r, t_min, best, is)) {
+        hit_ = true;
+        best = is.t;
+      }
+    return hit_;
+  }
+
+  /**
+   * @brief Whether any side of the cube blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True as soon as one side is hit
+   * @return false False if no side is hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    isect<T> is;
+    for (int k = 0; k < 2; k++)
+      if (xy_[k].xy_rectangle<T>::intersect(r, t_min, t_max, is) ||
+          xz_[k].xz_rectangle<T>::intersect(r, t_min, t_max, is) ||
+          yz_[k].yz_rectangle<T>::intersect(r, t_min, t_max, is))
+        return true;
+    return false;
   }
 
   /**
@@ -72,10 +111,12 @@ class cube : public hit<T> {
    */
   point3<T> max_;
   /**
-   * @brief Sides of the cube
+   * @brief Sides facing z, y and x, stored in the cube itself
    *
    */
-  hit_list<T> sides;
+  xy_rectangle<T> xy_[2];
+  xz_rectangle<T> xz_[2];
+  yz_rectangle<T> yz_[2];
 };
 
 /**
@@ -89,22 +130,22 @@ class cube : public hit<T> {
 template <typename T>
 cube<T>::cube(const point3<T>& min,
               const point3<T>& max,
-              std::shared_ptr<material<T>> m) {
+              const material<T>* m) {
   min_ = min;
   max_ = max;
 
-  sides.add(std::make_shared<xy_rectangle<T>>(
-      min.getX(), max.getX(), min.getY(), max.getY(), max.getZ(), m));
-  sides.add(std::make_shared<xy_rectangle<T>>(
-      min.getX(), max.getX(), min.getY(), max.getY(), min.getZ(), m));
+  xy_[0] = xy_rectangle<T>(min.getX(), max.getX(), min.getY(), max.getY(),
+                           max.getZ(), m);
+  xy_[1] = xy_rectangle<T>(min.getX(), max.getX(), min.getY(), max.getY(),
+                           min.getZ(), m);
 
-  sides.add(std::make_shared<xz_rectangle<T>>(
-      min.getX(), max.getX(), min.getZ(), max.getZ(), max.getY(), m));
-  sides.add(std::make_shared<xz_rectangle<T>>(
-      min.getX(), max.getX(), min.getZ(), max.getZ(), min.getY(), m));
+  xz_[0] = xz_rectangle<T>(min.getX(), max.getX(), min.getZ(), max.getZ(),
+                           max.getY(), m);
+  xz_[1] = xz_rectangle<T>(min.getX(), max.getX(), min.getZ(), max.getZ(),
+                           min.getY(), m);
 
-  sides.add(std::make_shared<yz_rectangle<T>>(
-      min.getY(), max.getY(), min.getZ(), max.getZ(), max.getX(), m));
-  sides.add(std::make_shared<yz_rectangle<T>>(
-      min.getY(), max.getY(), min.getZ(), max.getZ(), min.getX(), m));
+  yz_[0] = yz_rectangle<T>(min.getY(), max.getY(), min.getZ(), max.getZ(),
+                           max.getX(), m);
+  yz_[1] = yz_rectangle<T>(min.getY(), max.getY(), min.getZ(), max.getZ(),
+                           min.getX(), m);
 }
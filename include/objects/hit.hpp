@@ -2,6 +2,11 @@
  * @file hit.hpp
  * @author Dylan Bassi (bassidj@mcmaster.ca)
  * @brief Abstract object that can be hit by a ray
+ * @details Hitting is split in two phases. intersect only finds the closest
+ * hit and records the little needed to find it again (isect): distance,
+ * object, primitive and barycentrics. resolve then builds the full hit_rec
+ * (point, normal, material, uv) once, for the hit that was kept, instead of
+ * for every candidate along the way.
  * @version 0.1
  * @date 2020-12-04
  *
@@ -11,11 +16,148 @@
 
 #pragma once
 
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
 #include "bounding_box.hpp"
 
 // Forward decl
 template <typename T>
 class material;
+template <typename T>
+class hit;
+
+/**
+ * @brief Deepest nesting of transform wrappers an isect can record
+ *
+ */
+constexpr int isect_max_wrap = 8;
+
+/**
+ * @brief Minimal record of the closest hit found so far
+ * @details Transform wrappers (translation, rotations) push themselves on
+ * the way back up, innermost first, so resolve can redo their transforms.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct isect {
+  /**
+   * @brief Distance along the ray
+   *
+   */
+  T t;
+  /**
+   * @brief Surface coordinates or barycentrics of the hit
+   *
+   */
+  T u, v;
+  /**
+   * @brief Object that was hit
+   *
+   */
+  const hit<T>* obj;
+  /**
+   * @brief Primitive of the object that was hit (e.g mesh triangle)
+   *
+   */
+  uint32_t prim;
+  /**
+   * @brief Number of wrappers pushed
+   *
+   */
+  int depth;
+  /**
+   * @brief Wrappers around the object, innermost first
+   *
+   */
+  const hit<T>* wrap[isect_max_wrap];
+
+  /**
+   * @brief Record a new closest hit, dropping any wrappers of the old one
+   *
+   * @param o Object that was hit
+   * @param t_ Distance along the ray
+   * @param u_ First surface coordinate
+   * @param v_ Second surface coordinate
+   * @param prim_ Primitive of the object
+   */
+  void set(const hit<T>* o,
+           const T& t_,
+           const T& u_ = 0,
+           const T& v_ = 0,
+           uint32_t prim_ = 0) {
+    obj = o;
+    t = t_;
+    u = u_;
+    v = v_;
+    prim = prim_;
+    depth = 0;
+  }
+
+  /**
+   * @brief Record a wrapper around the hit object
+   *
+   * @param w Wrapper
+   */
+  void push(const hit<T>* w) {
+    // Deeper nestings are turned down when built, see wrapped_depth
+    assert(depth < isect_max_wrap);
+    wrap[depth++] = w;
+  }
+};
+
+/**
+ * @brief Point drawn on an emitter by light sampling
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct light_sample {
+  /**
+   * @brief Point on the emitter and its outward normal
+   *
+   */
+  point3<T> p;
+  vec3<T> n;
+  /**
+   * @brief Surface coordinates of the point, for the emission texture
+   *
+   */
+  T u, v;
+  /**
+   * @brief Density of the point per unit solid angle, seen from the origin
+   *
+   */
+  T pdf;
+};
+
+/**
+ * @brief Turn the density of a uniformly drawn point on a surface into a
+ * density per unit solid angle seen from o
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the surface is seen from
+ * @param area Area of the surface
+ * @param s Drawn point, its pdf is set
+ * @return true The point can be seen from o
+ * @return false The surface is seen edge on
+ */
+template <typename T>
+bool area_to_solid_angle(const point3<T>& o,
+                         const T& area,
+                         light_sample<T>& s) {
+  const vec3<T> d = s.p - o;
+  const T dist2 = d.norm_sqr();
+  const T cos = std::fabs(dot(d, s.n)) / std::sqrt(dist2);
+  if (!(cos > 0) || !(area > 0))
+    return false;
+  s.pdf = dist2 / (cos * area);
+  return true;
+}
 
 /**
  * @brief A structure to store the record of the ray
@@ -26,7 +168,10 @@ template <typename T>
 struct hit_rec {
   point3<T> p;
   vec3<T> n;
-  std::shared_ptr<material<T>> mat;
+  // Owned by the scene, a plain pointer keeps copies free of refcounting
+  const material<T>* mat;
+  // Object recorded by intersect, lets light sampling spot its own lights
+  const hit<T>* obj;
   T t, u, v;
   bool front;
 
@@ -44,6 +189,9 @@ struct hit_rec {
   }
 };
 
+template <typename T>
+void resolve(const ray<T>& r, const isect<T>& is, hit_rec<T>& rec);
+
 // Our base class for objects
 /**
  * @brief Base class for hittable objects
@@ -53,14 +201,138 @@ struct hit_rec {
 template <typename T>
 class hit {
  public:
-  //  Return whether an object is hit or not
   /**
-   * @brief Returns whether a ray intersects an object
+   * @brief Find the closest hit in [t_min, t_max]
+   * @details On a hit, is describes it and is.t is below t_max. On a miss,
+   * is is left untouched.
    *
    * @return true True if the ray hits the object
    * @return false False if the ray does not hit the object
    */
-  virtual bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const = 0;
+  virtual bool intersect(const ray<T>&,
+                         const T&,
+                         const T&,
+                         isect<T>&) const = 0;
+
+  /**
+   * @brief Whether anything blocks the ray in [t_min, t_max]
+   * @details Any hit will do, so containers stop at the first one they find
+   * instead of looking for the closest. Primitives fall back on intersect,
+   * which never touches shading data.
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True if the ray hits something
+   * @return false False if the ray is unblocked
+   */
+  virtual bool occluded(const ray<T>& r,
+                        const T& t_min,
+                        const T& t_max) const {
+    isect<T> is;
+    return intersect(r, t_min, t_max, is);
+  }
+
+  /**
+   * @brief Fill in the hit record of a hit this object recorded
+   * @details Only called on the object stored in isect::obj, with the ray in
+   * the object's own frame. t, u and v are already copied from the isect.
+   *
+   */
+  virtual void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const {}
+
+  /**
+   * @brief Material of the object if it is a light that sample can draw
+   * points on
+   *
+   * @return const material<T>* Emissive material, or null
+   */
+  virtual const material<T>* emitter() const { return nullptr; }
+
+  /**
+   * @brief Draw a point on the object as seen from o, for light sampling
+   *
+   * @param o Point the object is seen from
+   * @param a First coordinate of a point of the unit square
+   * @param b Second coordinate of a point of the unit square
+   * @param s Drawn point and its density
+   * @return true A point was drawn
+   * @return false The object can't be sampled from o
+   */
+  virtual bool sample(const point3<T>& o,
+                      const T& a,
+                      const T& b,
+                      light_sample<T>& s) const {
+    (void)o;
+    (void)a;
+    (void)b;
+    (void)s;
+    return false;
+  }
+
+  /**
+   * @brief Density with which sample draws a point of the object
+   *
+   * @param o Point the object is seen from
+   * @param p Point on the object, e.g where a ray from o hit it
+   * @return T Density per unit solid angle, 0 if sample can't draw p
+   */
+  virtual T pdf(const point3<T>& o, const point3<T>& p) const {
+    (void)o;
+    (void)p;
+    return 0;
+  }
+
+  /**
+   * @brief Map a ray into the frame of the wrapped object
+   *
+   * @param r Ray in the wrapper's frame
+   * @return ray<T> Ray in the wrapped object's frame
+   */
+  virtual ray<T> to_local(const ray<T>& r) const { return r; }
+
+  /**
+   * @brief Map a hit record back out of the frame of the wrapped object
+   *
+   * @param local Ray in the wrapped object's frame
+   * @param rec Hit record to transform
+   */
+  virtual void to_world(const ray<T>& local, hit_rec<T>& rec) const {
+    (void)local;
+    (void)rec;
+  }
+
+  /**
+   * @brief Return the deepest nesting of transform wrappers in the object
+   * @details Wrappers count themselves on top of what they wrap,
+   * containers take the deepest of their objects.
+   *
+   * @return int Wrappers an isect may record, 0 for a plain primitive
+   */
+  virtual int wrap_depth() const { return 0; }
+
+  /**
+   * @brief Returns whether a ray intersects an object, with the full record
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @param rec Hit record of the closest hit
+   * @return true True if the ray hits the object
+   * @return false False if the ray does not hit the object
+   */
+  bool is_hit(const ray<T>& r,
+              const T& t_min,
+              const T& t_max,
+              hit_rec<T>& rec) const {
+    isect<T> is;
+    if (!intersect(r, t_min, t_max, is))
+      return false;
+    resolve(r, is, rec);
+    return true;
+  }
+
+  virtual ~hit() = default;
   /**
    * @brief Returns if we are in an object's bounding box
    *
@@ -70,3 +342,50 @@ class hit {
    */
   virtual bool bound_box(const T&, const T&, BB<T>& out) const = 0;
 };
+
+/**
+ * @brief Return the wrapper depth of an object put in one more wrapper
+ * @details An isect has room for isect_max_wrap wrappers, a deeper nesting
+ * is turned down while the scene is built rather than losing wrappers, and
+ * with them the transforms, at render time.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param p Object being wrapped
+ * @return int Wrapper depth of the wrapper
+ */
+template <typename T>
+int wrapped_depth(const hit<T>* p) {
+  const int depth = p->wrap_depth() + 1;
+  if (depth > isect_max_wrap)
+    throw std::length_error("Transforms nested more than " +
+                            std::to_string(isect_max_wrap) + " deep");
+  return depth;
+}
+
+/**
+ * @brief Build the full hit record of a recorded hit
+ * @details Walks the ray down through the recorded wrappers, lets the hit
+ * object fill in the record in its own frame and maps the record back out.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param is Recorded hit
+ * @param rec Hit record to fill in
+ */
+template <typename T>
+void resolve(const ray<T>& r, const isect<T>& is, hit_rec<T>& rec) {
+  // The outermost wrapper was pushed last
+  ray<T> local[isect_max_wrap + 1];
+  local[0] = r;
+  for (int k = 0; k < is.depth; k++)
+    local[k + 1] = is.wrap[is.depth - 1 - k]->to_local(local[k]);
+
+  rec.t = is.t;
+  rec.u = is.u;
+  rec.v = is.v;
+  rec.obj = is.obj;
+  is.obj->surface(local[is.depth], is, rec);
+
+  for (int k = is.depth - 1; k >= 0; k--)
+    is.wrap[is.depth - 1 - k]->to_world(local[k + 1], rec);
+}
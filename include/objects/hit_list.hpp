@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "hit.hpp"
 
 /**
@@ -34,20 +36,14 @@ class hit_list : public hit<T> {
    *
    * @param obj Object to add to list
    */
-  explicit hit_list(std::shared_ptr<hit<T>> obj) { add(obj); }
-  /**
-   * @brief Construct a new hit list object from a hit list
-   *
-   * @param hit_l Hit list to pass into new list
-   */
-  explicit hit_list(std::shared_ptr<hit_list<T>> hit_l) : obj_list(hit_l) {}
+  explicit hit_list(const hit<T>* obj) { add(obj); }
 
   /**
    * @brief Append object to the hit list
    *
    * @param obj Object to add to list
    */
-  void add(std::shared_ptr<hit<T>> obj) { obj_list.push_back(obj); }
+  void add(const hit<T>* obj) { obj_list.push_back(obj); }
   /**
    * @brief Clear the object list
    *
@@ -63,9 +59,9 @@ class hit_list : public hit<T> {
   /**
    * @brief Return the objects in the hist list
    *
-   * @return std::vector<std::shared_ptr<hit<T>>> Vector of objects
+   * @return const std::vector<const hit<T>*>& Vector of objects
    */
-  std::vector<std::shared_ptr<hit<T>>> objects() const { return obj_list; }
+  const std::vector<const hit<T>*>& objects() const { return obj_list; }
 
   /**
    * @brief Compute whether ray intersects the hit list
@@ -73,7 +69,28 @@ class hit_list : public hit<T> {
    * @return true Returns true if object is hit
    * @return false Returns true if objects is hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Whether any object of the list blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True as soon as one object is hit
+   * @return false False if no object is hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    for (const hit<T>* obj : obj_list)
+      if (obj->occluded(r, t_min, t_max))
+        return true;
+    return false;
+  }
 
   /**
    * @brief Whether we are in the bounding box
@@ -101,12 +118,24 @@ class hit_list : public hit<T> {
     return true;
   }
 
+  /**
+   * @brief Return the deepest nesting of transform wrappers in the list
+   *
+   * @return int Wrapper depth of the deepest object
+   */
+  int wrap_depth() const override {
+    int depth = 0;
+    for (const hit<T>* obj : obj_list)
+      depth = std::max(depth, obj->wrap_depth());
+    return depth;
+  }
+
  private:
   /**
    * @brief Vector of objects in the hit list
    *
    */
-  std::vector<std::shared_ptr<hit<T>>> obj_list;
+  std::vector<const hit<T>*> obj_list;
 };
 
 /**
@@ -116,25 +145,23 @@ class hit_list : public hit<T> {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of ray
+ * @param is Closest hit so far
  * @return true Returns true if object is hit
  * @return false Returns true if objects is hit
  */
 template <typename T>
-bool hit_list<T>::is_hit(const ray<T>& r,
-                         const T& t_min,
-                         const T& t_max,
-                         hit_rec<T>& rec) const {
-  hit_rec<T> temp;
+bool hit_list<T>::intersect(const ray<T>& r,
+                            const T& t_min,
+                            const T& t_max,
+                            isect<T>& is) const {
   bool hit_ = false;
   T best_guess = t_max;
 
-  // Go through our obj list, see if they hit
-  for (const std::shared_ptr<hit<T>>& obj : obj_list) {
-    if (obj->is_hit(r, t_min, best_guess, temp)) {
+  // Go through our obj list, a hit only ever overwrites a farther one
+  for (const hit<T>* obj : obj_list) {
+    if (obj->intersect(r, t_min, best_guess, is)) {
       hit_ = true;
-      best_guess = temp.t;
-      rec = temp;
+      best_guess = is.t;
     }
   }
   return hit_;
@@ -32,10 +32,8 @@ class iso_fog : public hit<T> {
    * @param rho Density of the fog
    * @param c Color of the fog
    */
-  iso_fog(std::shared_ptr<hit<T>> bound, const T& rho, color<T> c)
-      : bound_(bound),
-        rho_(-1 / rho),
-        phase_(std::make_shared<isotropic<T>>(c)) {}
+  iso_fog(const hit<T>* bound, const T& rho, color<T> c)
+      : bound_(bound), rho_(-1 / rho), phase_(c) {}
   /**
    * @brief Construct a new iso fog object from a texture
    *
@@ -43,12 +41,8 @@ class iso_fog : public hit<T> {
    * @param rho Density of the fog
    * @param c Texture of the fog
    */
-  iso_fog(std::shared_ptr<hit<T>> bound,
-          const T& rho,
-          std::shared_ptr<uvTex<T>> c)
-      : bound_(bound),
-        rho_(-1 / rho),
-        phase_(std::make_shared<isotropic<T>>(c)) {}
+  iso_fog(const hit<T>* bound, const T& rho, const uvTex<T>* c)
+      : bound_(bound), rho_(-1 / rho), phase_(c) {}
 
   /**
    * @brief Returns whether a ray intersects the fog
@@ -56,7 +50,16 @@ class iso_fog : public hit<T> {
    * @return true True if the ray hits the fog
    * @return false False if the ray does not hit the fog
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal and phase function of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
 
   /**
    * @brief Returns whether we are inside the bounding box of the fog
@@ -76,17 +79,17 @@ class iso_fog : public hit<T> {
    * @brief Boundary object to make fog
    *
    */
-  std::shared_ptr<hit<T>> bound_;
+  const hit<T>* bound_{nullptr};
   /**
    * @brief Inverse density of fog
    *
    */
   T rho_;
   /**
-   * @brief Material to make fog
+   * @brief Material to make fog, kept in the fog itself
    *
    */
-  std::shared_ptr<material<T>> phase_;
+  isotropic<T> phase_;
 };
 
 /**
@@ -96,25 +99,26 @@ class iso_fog : public hit<T> {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of ray
+ * @param is Closest hit so far
  * @return true Returns true if object is hit
  * @return false Returns true if objects is hit
  */
 template <typename T>
-bool iso_fog<T>::is_hit(const ray<T>& r,
-                        const T& t_min,
-                        const T& t_max,
-                        hit_rec<T>& rec) const {
-  hit_rec<T> rec0, rec1;
+bool iso_fog<T>::intersect(const ray<T>& r,
+                           const T& t_min,
+                           const T& t_max,
+                           isect<T>& is) const {
+  // Only the distances are needed, the boundary is never shaded
+  isect<T> rec0, rec1;
 
   // if not hitting bounding box through passing
-  if (!bound_->is_hit(r, -inf<T>, inf<T>, rec0))
+  if (!bound_->intersect(r, -inf<T>, inf<T>, rec0))
     return false;
 
   // realizing now I hard code this 0.0001 acne factor a lot
   // FIXME: look back through code and replace acne with definition
   // if not hitting bound as we travel through
-  if (!bound_->is_hit(r, rec0.t + ACNE, inf<T>, rec1))
+  if (!bound_->intersect(r, rec0.t + ACNE, inf<T>, rec1))
     return false;
 
   // set min and max if over calcing
@@ -131,17 +135,31 @@ bool iso_fog<T>::is_hit(const ray<T>& r,
 
   const T r_len = r.direction().norm();
   const T d_bound = (rec1.t - rec0.t) * r_len;
+  // is_hit has no engine, so draw from the stream the renderer seeded
   const T dist = rho_ * std::log(random_double());
 
   // if scatter puts us outside
   if (dist > d_bound)
     return false;
 
-  rec.t = rec0.t + dist / r_len;
+  is.set(this, rec0.t + dist / r_len);
+  return true;
+}
+
+/**
+ * @brief Fill in the point, normal and phase function of a hit
+ * @details The normal is arbitrary, the phase function scatters evenly.
+ *
+ * @tparam T Datatype to be used
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t already set
+ */
+template <typename T>
+void iso_fog<T>::surface(const ray<T>& r,
+                         const isect<T>&,
+                         hit_rec<T>& rec) const {
   rec.p = r.at(rec.t);
   rec.n = vec3<T>(1, 0, 0);
   rec.front = true;
-  rec.mat = phase_;
-
-  return true;
+  rec.mat = &phase_;
 }
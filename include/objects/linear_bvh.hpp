@@ -0,0 +1,651 @@
+/**
+ * @file linear_bvh.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Flattened, pointer-free BVH with iterative traversal
+ * @details The tree is stored depth first in one array of 32 byte nodes. The
+ * left child of an interior node is the next node in the array and the
+ * offset points at the right child; a leaf's offset points at its first
+ * object. Traversal walks the array with a small fixed stack instead of
+ * recursing through virtual calls, visiting the child nearest the ray first.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bvh.hpp"
+#include "timer.hpp"
+
+/**
+ * @brief A node of a flattened BVH, 32 bytes
+ * @details Bounds are kept in float whatever the datatype, rounded outwards so
+ * the box never shrinks.
+ *
+ */
+struct lbvh_node {
+  /**
+   * @brief Lower and upper corners of the box
+   *
+   */
+  float min[3], max[3];
+  /**
+   * @brief Right child of an interior node, first object of a leaf
+   *
+   */
+  uint32_t offset;
+  /**
+   * @brief Number of objects in a leaf, 0 for interior nodes
+   *
+   */
+  uint16_t count;
+  /**
+   * @brief Axis the node was split on
+   *
+   */
+  uint8_t axis;
+  uint8_t pad;
+};
+
+static_assert(sizeof(lbvh_node) == 32, "lbvh_node must be 32 bytes");
+
+/**
+ * @brief Shape of a built BVH
+ *
+ */
+struct bvh_stats {
+  size_t prims = 0;
+  size_t nodes = 0;
+  size_t leaves = 0;
+  size_t max_depth = 0;
+  size_t max_leaf = 0;
+  double seconds = 0;
+};
+
+/**
+ * @brief Flattened BVH over a set of boxes
+ * @details Only stores the nodes and the order of the objects; the owner
+ * keeps the objects and intersects a leaf's range through a callback. The
+ * nodes are either built and owned by the tree or viewed in memory owned by
+ * someone else (e.g a mapped mesh cache).
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+class flat_bvh {
+ public:
+  /**
+   * @brief Deepest tree the traversal stack can handle
+   *
+   */
+  static constexpr int max_depth = 64;
+
+  /**
+   * @brief Build the tree, reordering the build records in place
+   * @details After the build, prims[k].id is the object at leaf slot k.
+   *
+   * @param prims Build records of the objects
+   * @param opt Build options
+   */
+  void build(std::vector<bvh_prim<T>>& prims, const bvh_options& opt) {
+    timer t;
+    nodes_.clear();
+    ext_ = nullptr;
+    ext_size_ = 0;
+    stats_ = bvh_stats();
+    stats_.prims = prims.size();
+    if (!prims.empty()) {
+      nodes_.reserve(2 * prims.size());
+      build(prims, 0, prims.size(), 0, opt);
+    }
+    stats_.nodes = nodes_.size();
+    t.end();
+    stats_.seconds = t.seconds();
+  }
+
+  /**
+   * @brief Return whether the tree is empty
+   *
+   * @return true The tree holds no objects
+   * @return false The tree holds objects
+   */
+  bool empty() const { return size() == 0; }
+
+  /**
+   * @brief Use nodes held elsewhere instead of building the tree
+   * @details The nodes must outlive the tree and use the same depth first
+   * layout build produces.
+   *
+   * @param nodes First node
+   * @param count Number of nodes
+   * @param stats Shape of the tree
+   */
+  void view(const lbvh_node* nodes, size_t count, const bvh_stats& stats) {
+    nodes_.clear();
+    ext_ = nodes;
+    ext_size_ = count;
+    stats_ = stats;
+  }
+
+  /**
+   * @brief Return the bounding box of the whole tree
+   *
+   * @return BB<T> Box of the root node
+   */
+  BB<T> bounds() const {
+    const lbvh_node& n = data()[0];
+    return BB<T>(point3<T>(n.min[0], n.min[1], n.min[2]),
+                 point3<T>(n.max[0], n.max[1], n.max[2]));
+  }
+
+  /**
+   * @brief Return the nodes, depth first
+   *
+   * @return const lbvh_node* First node of the tree
+   */
+  const lbvh_node* data() const { return ext_ ? ext_ : nodes_.data(); }
+  /**
+   * @brief Return the number of nodes
+   *
+   * @return size_t Number of nodes
+   */
+  size_t size() const { return ext_ ? ext_size_ : nodes_.size(); }
+
+  /**
+   * @brief Return the shape of the tree
+   *
+   * @return const bvh_stats& Build statistics
+   */
+  const bvh_stats& stats() const { return stats_; }
+
+  /**
+   * @brief Walk the tree, handing every leaf the ray reaches to a callback
+   * @details leaf(first, count, t_max) intersects objects [first,first+count)
+   * and returns whether one was hit, lowering t_max to the closest hit.
+   *
+   * @tparam F Leaf callback
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time, lowered to the closest hit
+   * @param leaf Leaf callback
+   * @return true True if any leaf reported a hit
+   * @return false False if nothing was hit
+   */
+  template <typename F>
+  bool traverse(const ray<T>& r, const T& t_min, T& t_max, F&& leaf) const {
+    const lbvh_node* nodes = data();
+    if (size() == 0)
+      return false;
+
+    const point3<T> o = r.origin();
+    const vec3<T> d = r.direction();
+    const T inv[3] = {static_cast<T>(1) / d[0], static_cast<T>(1) / d[1],
+                      static_cast<T>(1) / d[2]};
+    const bool neg[3] = {inv[0] < 0, inv[1] < 0, inv[2] < 0};
+    const T org[3] = {o[0], o[1], o[2]};
+
+    uint32_t stack[max_depth];
+    int sp = 0;
+    uint32_t idx = 0;
+    bool found = false;
+
+    while (true) {
+      const lbvh_node& n = nodes[idx];
+      if (slab(n, org, inv, neg, t_min, t_max)) {
+        if (n.count > 0) {
+          if (leaf(n.offset, n.count, t_max))
+            found = true;
+        } else {
+          // Go down the near side first, the far side waits on the stack
+          if (neg[n.axis]) {
+            stack[sp++] = idx + 1;
+            idx = n.offset;
+          } else {
+            stack[sp++] = n.offset;
+            idx = idx + 1;
+          }
+          continue;
+        }
+      }
+      if (sp == 0)
+        break;
+      idx = stack[--sp];
+    }
+    return found;
+  }
+
+  /**
+   * @brief Walk the tree until a leaf reports a hit
+   * @details leaf(first, count) tests objects [first,first+count) and returns
+   * whether any of them blocks the ray; the walk stops at the first that
+   * does, so no leaf needs the closest hit.
+   *
+   * @tparam F Leaf callback
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @param leaf Leaf callback
+   * @return true True if a leaf reported a hit
+   * @return false False if nothing blocks the ray
+   */
+  template <typename F>
+  bool any(const ray<T>& r, const T& t_min, const T& t_max, F&& leaf) const {
+    const lbvh_node* nodes = data();
+    if (size() == 0)
+      return false;
+
+    const point3<T> o = r.origin();
+    const vec3<T> d = r.direction();
+    const T inv[3] = {static_cast<T>(1) / d[0], static_cast<T>(1) / d[1],
+                      static_cast<T>(1) / d[2]};
+    const bool neg[3] = {inv[0] < 0, inv[1] < 0, inv[2] < 0};
+    const T org[3] = {o[0], o[1], o[2]};
+
+    uint32_t stack[max_depth];
+    int sp = 0;
+    uint32_t idx = 0;
+
+    while (true) {
+      const lbvh_node& n = nodes[idx];
+      if (slab(n, org, inv, neg, t_min, t_max)) {
+        if (n.count == 0) {
+          stack[sp++] = n.offset;
+          idx = idx + 1;
+          continue;
+        }
+        if (leaf(n.offset, n.count))
+          return true;
+      }
+      if (sp == 0)
+        return false;
+      idx = stack[--sp];
+    }
+  }
+
+ private:
+  template <typename>
+  friend class linear_bvh;
+
+  /**
+   * @brief Ray/box slab test against a node
+   *
+   */
+  static bool slab(const lbvh_node& n,
+                   const T* org,
+                   const T* inv,
+                   const bool* neg,
+                   const T& t_min,
+                   const T& t_max) {
+    T ti = t_min;
+    T tf = t_max;
+    for (int a = 0; a < 3; a++) {
+      T t0 = (static_cast<T>(neg[a] ? n.max[a] : n.min[a]) - org[a]) * inv[a];
+      T t1 = (static_cast<T>(neg[a] ? n.min[a] : n.max[a]) - org[a]) * inv[a];
+      ti = t0 > ti ? t0 : ti;
+      tf = t1 < tf ? t1 : tf;
+      if (tf < ti)
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Store a box in a node, rounding outwards to float
+   *
+   */
+  static void set_box(lbvh_node& n, const BB<T>& b) {
+    for (int a = 0; a < 3; a++) {
+      float lo = static_cast<float>(b.min()[a]);
+      float hi = static_cast<float>(b.max()[a]);
+      if (static_cast<T>(lo) > b.min()[a])
+        lo = std::nextafter(lo, -INFINITY);
+      if (static_cast<T>(hi) < b.max()[a])
+        hi = std::nextafter(hi, INFINITY);
+      n.min[a] = lo;
+      n.max[a] = hi;
+    }
+  }
+
+  /**
+   * @brief Build the subtree over records [start,end)
+   *
+   * @return uint32_t Index of the subtree's root node
+   */
+  uint32_t build(std::vector<bvh_prim<T>>& p,
+                 const size_t& start,
+                 const size_t& end,
+                 const size_t& depth,
+                 const bvh_options& opt) {
+    const uint32_t idx = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(lbvh_node());
+
+    BB<T> box = empty_box<T>();
+    BB<T> cbox = empty_box<T>();
+    for (size_t i = start; i < end; i++) {
+      box = surround_box(box, p[i].box);
+      cbox = surround_box(cbox, BB<T>(p[i].c, p[i].c));
+    }
+    set_box(nodes_[idx], box);
+    stats_.max_depth = std::max(stats_.max_depth, depth);
+
+    const size_t n = end - start;
+    size_t mid = start;
+    int axis = cbox.axis();
+    // Deep in a lopsided tree fall back to halving so the stack can't overflow
+    const bool halve = depth + 32 >= max_depth;
+
+    if (opt.split == bvh_split::sah && !halve) {
+      mid = sah_partition(p, start, end, opt);
+    } else if (n > std::max<size_t>(1, opt.leaf_size)) {
+      if (!halve)
+        axis = random_int(0, 2);
+      mid = start + n / 2;
+      std::nth_element(p.begin() + start, p.begin() + mid, p.begin() + end,
+                       [axis](const bvh_prim<T>& a, const bvh_prim<T>& b) {
+                         return a.c[axis] < b.c[axis];
+                       });
+    }
+    // The count field is 16 bits
+    if (mid == start && n > UINT16_MAX)
+      mid = start + n / 2;
+
+    if (mid == start || mid == end) {
+      nodes_[idx].offset = static_cast<uint32_t>(start);
+      nodes_[idx].count = static_cast<uint16_t>(n);
+      nodes_[idx].axis = static_cast<uint8_t>(axis);
+      stats_.leaves++;
+      stats_.max_leaf = std::max(stats_.max_leaf, n);
+      return idx;
+    }
+
+    build(p, start, mid, depth + 1, opt);
+    uint32_t right = build(p, mid, end, depth + 1, opt);
+    nodes_[idx].offset = right;
+    nodes_[idx].count = 0;
+    nodes_[idx].axis = static_cast<uint8_t>(axis);
+    return idx;
+  }
+
+  /**
+   * @brief Nodes of the tree, depth first
+   *
+   */
+  std::vector<lbvh_node> nodes_;
+  /**
+   * @brief Nodes held elsewhere, used instead of nodes_ when set
+   *
+   */
+  const lbvh_node* ext_{nullptr};
+  /**
+   * @brief Number of nodes held elsewhere
+   *
+   */
+  size_t ext_size_{0};
+  /**
+   * @brief Shape of the tree
+   *
+   */
+  bvh_stats stats_;
+};
+
+/**
+ * @brief Hittable wrapper of a flattened BVH over a list of objects
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+class linear_bvh : public hit<T> {
+ public:
+  /**
+   * @brief Construct an uninitialized linear bvh object
+   *
+   */
+  linear_bvh() {}
+  /**
+   * @brief Construct a new linear bvh object over every object of a list
+   * @details bvh_node and hit_list objects are opened up so their contents
+   * are placed directly in the flat tree.
+   *
+   * @param l Hit list
+   * @param t0 Initial shutter time
+   * @param t1 Final shutter time
+   * @param opt Build options
+   */
+  linear_bvh(const hit_list<T>& l,
+             const T& t0,
+             const T& t1,
+             const bvh_options& opt = bvh_defaults()) {
+    std::vector<const hit<T>*> obj;
+    for (const hit<T>* o : l.objects())
+      gather(o, obj);
+    build(obj, t0, t1, opt);
+  }
+  /**
+   * @brief Construct a new linear bvh object by flattening a built tree
+   * @details Every node of the tree becomes a node of the array and the
+   * leaves keep the objects they had. Trees too deep for the traversal stack
+   * are rebuilt with the default builder instead.
+   *
+   * @param root Root of the tree
+   * @param t0 Initial shutter time
+   * @param t1 Final shutter time
+   */
+  linear_bvh(const bvh_node<T>* root,
+             const T& t0,
+             const T& t1) {
+    flatten(root, t0, t1, 0);
+    tree_.stats_.prims = obj_.size();
+    tree_.stats_.nodes = tree_.nodes_.size();
+
+    if (tree_.stats_.max_depth >= flat_bvh<T>::max_depth) {
+      std::vector<const hit<T>*> obj;
+      gather(root, obj);
+      build(obj, t0, t1, bvh_defaults());
+    }
+  }
+
+  /**
+   * @brief Whether we are in the bounding box
+   *
+   * @param out Bounding box of the tree
+   * @return true True if the tree holds objects
+   * @return false False if the tree is empty
+   */
+  bool bound_box(const T&, const T&, BB<T>& out) const override {
+    if (tree_.empty())
+      return false;
+    out = tree_.bounds();
+    return true;
+  }
+
+  /**
+   * @brief Return the deepest nesting of transform wrappers in the tree
+   *
+   * @return int Wrapper depth of the deepest object
+   */
+  int wrap_depth() const override {
+    int depth = 0;
+    for (const hit<T>* o : obj_)
+      depth = std::max(depth, o->wrap_depth());
+    return depth;
+  }
+
+  /**
+   * @brief Compute whether ray intersects the tree
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @param is Closest hit so far
+   * @return true True if object is hit
+   * @return false False if object is not hit
+   */
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override {
+    T best = t_max;
+    return tree_.traverse(r, t_min, best, [&](uint32_t first, uint16_t count,
+                                               T& t_best) {
+      bool hit_ = false;
+      for (uint32_t k = first; k < first + count; k++) {
+        if (obj_[k]->intersect(r, t_min, t_best, is)) {
+          hit_ = true;
+          t_best = is.t;
+        }
+      }
+      return hit_;
+    });
+  }
+
+  /**
+   * @brief Whether any object in the tree blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True as soon as one object is hit
+   * @return false False if no object is hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    return tree_.any(r, t_min, t_max, [&](uint32_t first, uint16_t count) {
+      for (uint32_t k = first; k < first + count; k++)
+        if (obj_[k]->occluded(r, t_min, t_max))
+          return true;
+      return false;
+    });
+  }
+
+  /**
+   * @brief Return the shape of the tree
+   *
+   * @return const bvh_stats& Build statistics
+   */
+  const bvh_stats& stats() const { return tree_.stats(); }
+
+ private:
+  /**
+   * @brief Collect the objects of a list, opening up trees and lists
+   *
+   */
+  static void gather(const hit<T>* o, std::vector<const hit<T>*>& out) {
+    if (auto node = dynamic_cast<const bvh_node<T>*>(o)) {
+      gather(node->left(), out);
+      if (node->right() && node->right() != node->left())
+        gather(node->right(), out);
+    } else if (auto list = dynamic_cast<const hit_list<T>*>(o)) {
+      for (const hit<T>* c : list->objects())
+        gather(c, out);
+    } else {
+      out.push_back(o);
+    }
+  }
+
+  /**
+   * @brief Build the tree over a set of objects with the builder
+   *
+   */
+  void build(const std::vector<const hit<T>*>& obj,
+             const T& t0,
+             const T& t1,
+             const bvh_options& opt) {
+    std::vector<bvh_prim<T>> prims(obj.size());
+    for (size_t i = 0; i < obj.size(); i++)
+      prims[i] = make_prim(*obj[i], i, t0, t1);
+    tree_.build(prims, opt);
+    order(obj, prims);
+  }
+
+  /**
+   * @brief Copy a subtree of an existing tree into the flat array
+   *
+   * @return uint32_t Index of the subtree's root node
+   */
+  uint32_t flatten(const hit<T>* h,
+                   const T& t0,
+                   const T& t1,
+                   const size_t& depth) {
+    auto node = dynamic_cast<const bvh_node<T>*>(h);
+    // Single object nodes point both children at the same object
+    if (node && (!node->right() || node->right() == node->left()))
+      return flatten(node->left(), t0, t1, depth);
+
+    BB<T> box;
+    if (!h->bound_box(t0, t1, box))
+      std::cerr << "No box in linear_bvh constructor \n";
+
+    const uint32_t idx = static_cast<uint32_t>(tree_.nodes_.size());
+    tree_.nodes_.push_back(lbvh_node());
+    flat_bvh<T>::set_box(tree_.nodes_[idx], box);
+    tree_.nodes_[idx].axis = static_cast<uint8_t>(box.axis());
+    tree_.stats_.max_depth = std::max(tree_.stats_.max_depth, depth);
+
+    if (node) {
+      flatten(node->left(), t0, t1, depth + 1);
+      uint32_t right = flatten(node->right(), t0, t1, depth + 1);
+      tree_.nodes_[idx].offset = right;
+      tree_.nodes_[idx].count = 0;
+      return idx;
+    }
+
+    std::vector<const hit<T>*> leaf;
+    if (auto list = dynamic_cast<const hit_list<T>*>(h))
+      leaf = list->objects();
+    else
+      leaf.push_back(h);
+
+    tree_.nodes_[idx].offset = static_cast<uint32_t>(obj_.size());
+    tree_.nodes_[idx].count = static_cast<uint16_t>(leaf.size());
+    obj_.insert(obj_.end(), leaf.begin(), leaf.end());
+    tree_.stats_.leaves++;
+    tree_.stats_.max_leaf = std::max(tree_.stats_.max_leaf, leaf.size());
+    return idx;
+  }
+
+  /**
+   * @brief Make a build record for an object
+   *
+   */
+  static bvh_prim<T> make_prim(const hit<T>& o,
+                               const size_t& id,
+                               const T& t0,
+                               const T& t1) {
+    bvh_prim<T> p;
+    if (!o.bound_box(t0, t1, p.box))
+      std::cerr << "No box in linear_bvh constructor \n";
+    p.c = static_cast<T>(0.5) * (p.box.min() + p.box.max());
+    p.id = id;
+    return p;
+  }
+
+  /**
+   * @brief Store the objects in leaf order
+   *
+   */
+  void order(const std::vector<const hit<T>*>& obj,
+             const std::vector<bvh_prim<T>>& prims) {
+    obj_.clear();
+    obj_.reserve(prims.size());
+    for (const auto& p : prims)
+      obj_.push_back(obj[p.id]);
+  }
+
+  /**
+   * @brief The flattened tree
+   *
+   */
+  flat_bvh<T> tree_;
+  /**
+   * @brief Objects in leaf order, owned by the scene
+   *
+   */
+  std::vector<const hit<T>*> obj_;
+};
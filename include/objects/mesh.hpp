@@ -1,118 +1,395 @@
+/**
+ * @file mesh.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Indexed triangle mesh loaded from a .obj file
+ * @details The mesh keeps one shared vertex array, three 32 bit indices per
+ * triangle and a single material, instead of a triangle object per face.
+ * It builds its own flattened BVH over the triangles, so a ray reaching the
+ * mesh only tests the few triangles near it instead of every face. Triangles
+ * are stored in the order of the BVH leaves and addressed by index, and each
+ * leaf is also packed into SIMD batches (see tri_batch.hpp) that are tested
+ * against the ray several triangles at a time. The
+ * parsed mesh and its BVH are cached next to the .obj file (see
+ * mesh_cache.hpp) and later loads use the mapped cache directly.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
 #pragma once
 
-#include <fstream>
-#include <sstream>
+#include <cstdint>
 
 #include "hit.hpp"
-#include "hit_list.hpp"
+#include "io/mesh_cache.hpp"
+#include "io/obj_loader.hpp"
+#include "linear_bvh.hpp"
 #include "materials/material.hpp"
+#include "tri_batch.hpp"
 #include "triangle.hpp"
 
+/**
+ * @brief Triangle mesh with its own acceleration structure
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
 template <typename T>
 class mesh : public hit<T> {
  public:
+  /**
+   * @brief Construct an uninitialized mesh object
+   *
+   */
   mesh() {}
-  mesh(const std::string& file, std::shared_ptr<material<T>> m);
+  /**
+   * @brief Construct a new mesh object from a .obj file
+   *
+   */
+  mesh(const std::string& file,
+       const material<T>* m,
+       const bvh_options& opt = bvh_defaults(),
+       bool cache = true);
 
-  void print() const {}
+  // The vertex and index views may point into the mesh's own storage
+  mesh(const mesh&) = delete;
+  mesh& operator=(const mesh&) = delete;
 
-  bool is_hit(const ray<T>& r,
-              const T& t_min,
-              const T& t_max,
-              hit_rec<T>& rec) const override;
+  /**
+   * @brief Print the size of the mesh and the shape of its BVH
+   *
+   */
+  void print() const {
+    const bvh_stats& s = tree_.stats();
+    std::cerr << "Mesh: " << nv_ << " vertices, " << size()
+              << " triangles, BVH of " << s.nodes << " nodes (" << s.leaves
+              << " leaves, depth " << s.max_depth << ", largest leaf "
+              << s.max_leaf << ") " << (cached_ ? "loaded from cache" : "built")
+              << " in " << s.seconds << " seconds, " << bytes() / 1024
+              << " KiB.\n";
+  }
+
+  /**
+   * @brief Return the number of triangles
+   *
+   * @return size_t Number of triangles
+   */
+  size_t size() const { return nt_; }
+
+  /**
+   * @brief Return the memory held by the vertices, indices and BVH
+   *
+   * @return size_t Size in bytes
+   */
+  size_t bytes() const {
+    return nv_ * sizeof(point3<T>) + 3 * nt_ * sizeof(uint32_t) +
+           tree_.size() * sizeof(lbvh_node) + batches_.bytes();
+  }
+
+  /**
+   * @brief Return the shape of the mesh's BVH
+   *
+   * @return const bvh_stats& Build statistics
+   */
+  const bvh_stats& stats() const { return tree_.stats(); }
+
+  /**
+   * @brief Compute whether ray intersects the mesh
+   *
+   * @return true True if any triangle is hit
+   * @return false False if no triangle is hit
+   */
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override;
+
+  /**
+   * @brief Whether any triangle blocks the ray
+   *
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override;
 
+  /**
+   * @brief Fill in the point, normal and material of the triangle hit
+   *
+   */
+  void surface(const ray<T>& r,
+               const isect<T>& is,
+               hit_rec<T>& rec) const override;
+
+  /**
+   * @brief Whether we are in the bounding box
+   *
+   * @param out Bounding box of the mesh
+   * @return true True if the mesh has triangles
+   * @return false False if the mesh is empty
+   */
   bool bound_box(const T&, const T&, BB<T>& out) const override {
+    if (tree_.empty())
+      return false;
     out = BB<T>(min_, max_);
     return true;
   }
 
  private:
-  std::shared_ptr<material<T>> m_;
-  std::ifstream file_;
+  /**
+   * @brief Build the BVH and store the triangles in leaf order
+   *
+   * @param faces Three vertex indices per triangle, in file order
+   * @param n Number of triangles
+   * @param opt Build options
+   */
+  void index(const uint32_t* faces, size_t n, const bvh_options& opt);
+
+  /**
+   * @brief Material of the mesh
+   *
+   */
+  const material<T>* m_{nullptr};
+  /**
+   * @brief Corners of the mesh's bounding box
+   *
+   */
   point3<T> min_, max_;
-  hit_list<T> faces;
-  std::vector<vec3<T>> verts;
-  //   triangle<T>* faces[];
-  //   vec3<T>* verts[];
+  /**
+   * @brief Vertices of the mesh, in vstore_ or the cache
+   *
+   */
+  const point3<T>* verts_{nullptr};
+  /**
+   * @brief Three vertex indices per triangle, in the order of the BVH leaves,
+   * in istore_ or the cache
+   *
+   */
+  const uint32_t* ids_{nullptr};
+  /**
+   * @brief Number of vertices and triangles
+   *
+   */
+  size_t nv_{0}, nt_{0};
+  /**
+   * @brief Vertices and indices owned by the mesh when not mapped
+   *
+   */
+  std::vector<point3<T>> vstore_;
+  std::vector<uint32_t> istore_;
+  /**
+   * @brief Mapped cache the views point into, if any
+   *
+   */
+  std::shared_ptr<mapped_file> map_;
+  /**
+   * @brief Whether the BVH came from the cache
+   *
+   */
+  bool cached_{false};
+  /**
+   * @brief BVH over the triangles
+   *
+   */
+  flat_bvh<T> tree_;
+  /**
+   * @brief Triangles of the BVH's leaves packed for the SIMD kernel
+   *
+   */
+  tri_batches batches_;
 };
 
+/**
+ * @brief Construct a new mesh<T>::mesh object from a .obj file
+ * @details A valid cache is mapped and used as is. If it was built with
+ * other BVH options only the tree is rebuilt. Otherwise the .obj file is
+ * parsed and, if caching is on, the result is written out for next time.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param file Name of the .obj file
+ * @param m Material of the mesh
+ * @param base Options for building the mesh's BVH
+ * @param cache Whether to read and write the mesh cache
+ */
 template <typename T>
-mesh<T>::mesh(const std::string& file, std::shared_ptr<material<T>> m) : m_(m) {
-  std::ifstream file_(file);
-  std::string line, op;
-  std::stringstream lstream;
-  std::vector<std::string> ss;
-
-  vec3<T> temp_pos;
-  T x, y, z;
-  int count{0};
-  int i = 0;
-  T minx(10), miny(10), minz(10);
-  T maxx(0), maxy(0), maxz(0);
-  while (std::getline(file_, line)) {
-    lstream << line;
-    lstream >> op;
-    ss = split<T>(line, ' ');
-    // std::cerr << ss[0] << "\n";
-    if (line[0] == 'v') {
-      // std::cerr << "PRINT \n";
-      // lstream >> x >> y >> z;
-      x = std::stod(ss[1]);
-      y = std::stod(ss[2]);
-      z = std::stod(ss[3]);
-      if (x > minx)
-        maxx = x;
-      if (y > miny)
-        maxy = y;
-      if (z > minz)
-        maxz = z;
-      if (x < minx)
-        minx = x;
-      if (y < miny)
-        miny = y;
-      if (z < minz)
-        minz = z;
-
-      point3<T> temp_vert(x, y, z);
-      verts.push_back(1.0 * temp_vert);
-    } else if (line[0] == 'f') {
-      int v0, v1, v2;
-      v0 = std::stoi(ss[1]);
-      v1 = std::stoi(ss[2]);
-      v2 = std::stoi(ss[3]);
-      // lstream >> v0 >> v1 >> v2;
-      faces.add(std::make_shared<triangle<T>>(
-          verts.at(v0 - 1), verts.at(v1 - 1), verts.at(v2 - 1), 0, m));
+mesh<T>::mesh(const std::string& file,
+              const material<T>* m,
+              const bvh_options& base,
+              bool cache)
+    : m_(m) {
+  // A leaf is tested a whole batch at a time, so let the SAH fill leaves
+  // with a few batches' worth of triangles
+  bvh_options opt = base;
+  opt.batch = tri_lanes;
+  opt.leaf_size = std::max<size_t>(opt.leaf_size, 3 * tri_lanes);
+
+  timer t;
+  mesh_cache<T> c;
+  bool write = cache;
+  if (cache && open_mesh_cache(file, opt, c)) {
+    map_ = c.map;
+    verts_ = c.verts;
+    nv_ = c.n_verts;
+    if (c.nodes) {
+      ids_ = c.ids;
+      nt_ = c.n_ids / 3;
+      t.end();
+      c.stats.seconds = t.seconds();
+      tree_.view(c.nodes, c.n_nodes, c.stats);
+      cached_ = true;
+      write = false;
+      if (c.batches)
+        batches_.view(c.batches, c.n_batches, c.first, nt_);
+      else
+        batches_.build(verts_, ids_, nt_, tree_);
+    } else {
+      index(c.ids, c.n_ids / 3, opt);
     }
+  } else {
+    obj_data<T> obj = load_obj<T>(file);
+    vstore_ = std::move(obj.verts);
+    verts_ = vstore_.data();
+    nv_ = vstore_.size();
+    index(obj.ids.data(), obj.ids.size() / 3, opt);
+  }
+
+  if (write && nt_ > 0 &&
+      !write_mesh_cache(file, opt, verts_, nv_, ids_, 3 * nt_, tree_,
+                        batches_))
+    std::cerr << "Could not write mesh cache " << mesh_cache_path(file)
+              << "\n";
+
+  if (!tree_.empty()) {
+    BB<T> b = tree_.bounds();
+    min_ = b.min();
+    max_ = b.max();
   }
-  min_ = point3<T>(minx, miny, minz);
-  max_ = point3<T>(maxx, maxy, maxz);
 }
 
+/**
+ * @brief Build the BVH and store the triangles in leaf order
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param faces Three vertex indices per triangle, in file order
+ * @param n Number of triangles
+ * @param opt Build options
+ */
 template <typename T>
-bool mesh<T>::is_hit(const ray<T>& r,
-                     const T& t_min,
-                     const T& t_max,
-                     hit_rec<T>& rec) const {
-  return faces.is_hit(r, t_min, t_max, rec);
-  // vec3<T> n(0, 0, 0);
-  // T thit = 10000000.0;
-  // T t = t_max;
-
-  // bool hit = false;
-  // for (auto& f : faces) {
-  //   if (f.is_hit(r, t_min, t_max, rec)) {
-  //     if (rec.t < thit) {
-  //       thit = rec.t;
-  //       n = rec.n;
-  //     }
-  //     hit = true;
-  //   }
-  // }
-
-  // rec.t = t;
-  // rec.p = r.at(t);
-  // rec.set_face(r, n);
-  // rec.n = n;
-  // return hit;
-}
\ No newline at end of file
+void mesh<T>::index(const uint32_t* faces, size_t n, const bvh_options& opt) {
+  std::vector<bvh_prim<T>> prims(n);
+  for (size_t i = 0; i < n; i++) {
+    const point3<T>& a = verts_[faces[3 * i]];
+    const point3<T>& b = verts_[faces[3 * i + 1]];
+    const point3<T>& c = verts_[faces[3 * i + 2]];
+    point3<T> lo, hi;
+    for (int k = 0; k < 3; k++) {
+      lo[k] = std::min<T>({a[k], b[k], c[k]});
+      hi[k] = std::max<T>({a[k], b[k], c[k]});
+    }
+    prims[i].box = BB<T>(lo, hi);
+    prims[i].c = static_cast<T>(0.5) * (lo + hi);
+    prims[i].id = i;
+  }
+  tree_.build(prims, opt);
+
+  // Store the triangles in leaf order so a leaf is one contiguous run
+  std::vector<uint32_t> ids(3 * n);
+  for (size_t k = 0; k < n; k++)
+    for (int j = 0; j < 3; j++)
+      ids[3 * k + j] = faces[3 * prims[k].id + j];
+  istore_ = std::move(ids);
+  ids_ = istore_.data();
+  nt_ = n;
+  batches_.build(verts_, ids_, nt_, tree_);
+}
+
+/**
+ * @brief Compute whether the ray intersects the mesh
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray to compute
+ * @param t_min Initial shutter time
+ * @param t_max Final shutter time
+ * @param is Closest hit so far
+ * @return true True if any triangle is hit
+ * @return false False if no triangle is hit
+ */
+template <typename T>
+bool mesh<T>::intersect(const ray<T>& r,
+                        const T& t_min,
+                        const T& t_max,
+                        isect<T>& is) const {
+  const point3<T> o = r.origin();
+  const vec3<T> d = r.direction();
+  const tri_ray fr = {{static_cast<float>(o[0]), static_cast<float>(o[1]),
+                       static_cast<float>(o[2])},
+                      {static_cast<float>(d[0]), static_cast<float>(d[1]),
+                       static_cast<float>(d[2])}};
+  const float f_min = static_cast<float>(t_min);
+
+  T best = t_max;
+  uint32_t id = 0;
+  float hu = 0, hv = 0;
+  bool hit_ = tree_.traverse(
+      r, t_min, best, [&](uint32_t first, uint16_t count, T& t_best) {
+        float t = static_cast<float>(std::min<T>(t_best, FLT_MAX));
+        float u = 0, v = 0;
+        if (!batches_.intersect(fr, first, count, f_min, t, id, u, v))
+          return false;
+        t_best = t;
+        hu = u;
+        hv = v;
+        return true;
+      });
+  if (!hit_)
+    return false;
+  is.set(this, best, hu, hv, id);
+  return true;
+}
+
+/**
+ * @brief Whether any triangle blocks the ray
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray to compute
+ * @param t_min Initial shutter time
+ * @param t_max Final shutter time
+ * @return true True as soon as one triangle is hit
+ * @return false False if no triangle is hit
+ */
+template <typename T>
+bool mesh<T>::occluded(const ray<T>& r,
+                       const T& t_min,
+                       const T& t_max) const {
+  const point3<T> o = r.origin();
+  const vec3<T> d = r.direction();
+  const tri_ray fr = {{static_cast<float>(o[0]), static_cast<float>(o[1]),
+                       static_cast<float>(o[2])},
+                      {static_cast<float>(d[0]), static_cast<float>(d[1]),
+                       static_cast<float>(d[2])}};
+  const float f_min = static_cast<float>(t_min);
+  const float f_max = static_cast<float>(std::min<T>(t_max, FLT_MAX));
+  return tree_.any(r, t_min, t_max, [&](uint32_t first, uint16_t count) {
+    return batches_.any(fr, first, count, f_min, f_max);
+  });
+}
+
+/**
+ * @brief Fill in the point, normal and material of the triangle hit
+ * @details Only the closest triangle needs its normal, so it is computed
+ * here from the triangle id recorded by intersect.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param is Recorded hit
+ * @param rec Hit record, with t, u and v already set
+ */
+template <typename T>
+void mesh<T>::surface(const ray<T>& r,
+                      const isect<T>& is,
+                      hit_rec<T>& rec) const {
+  const uint32_t* f = &ids_[3 * static_cast<size_t>(is.prim)];
+  const point3<T>& v0 = verts_[f[0]];
+  rec.set_face(r, unit_v(cross(verts_[f[1]] - v0, verts_[f[2]] - v0)));
+  rec.mat = m_;
+  rec.p = r.at(rec.t);
+}
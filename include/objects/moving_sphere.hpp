@@ -42,7 +42,7 @@ class moving_sphere : public hit<T> {
                 const T& t0,
                 const T& t1,
                 const T& r,
-                std::shared_ptr<material<T>> m)
+                const material<T>* m)
       : mat(m), c0_(cen0), c1_(cen1), t0_(t0), t1_(t1), r_(r) {}
 
   /**
@@ -66,7 +66,16 @@ class moving_sphere : public hit<T> {
    * @return true True if the sphere is hit
    * @return false False if the sphere is not hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal and material of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -91,7 +100,7 @@ class moving_sphere : public hit<T> {
    * @brief Material of the sphere
    *
    */
-  std::shared_ptr<material<T>> mat;
+  const material<T>* mat{nullptr};
   /**
    * @brief Center of the sphere at initial and final shutter time
    *
@@ -129,15 +138,15 @@ point3<T> moving_sphere<T>::center(const T& t) const {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of the ray
+ * @param is Closest hit so far
  * @return true True if the sphere is hit
  * @return false False if the sphere is not hit
  */
 template <typename T>
-bool moving_sphere<T>::is_hit(const ray<T>& r,
-                              const T& t_min,
-                              const T& t_max,
-                              hit_rec<T>& rec) const {
+bool moving_sphere<T>::intersect(const ray<T>& r,
+                                 const T& t_min,
+                                 const T& t_max,
+                                 isect<T>& is) const {
   // Ray from origin to center of moving_sphere
   vec3<T> oc = r.origin() - center(r.time());
 
@@ -161,10 +170,23 @@ bool moving_sphere<T>::is_hit(const ray<T>& r,
       return false;
   }
 
-  rec.t = soln;
+  is.set(this, soln);
+  return true;
+}
+
+/**
+ * @brief Fill in the point, normal and material of a hit
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t already set
+ */
+template <typename T>
+void moving_sphere<T>::surface(const ray<T>& r,
+                               const isect<T>&,
+                               hit_rec<T>& rec) const {
   rec.p = r.at(rec.t);
   vec3<T> n_out = (rec.p - center(r.time())) / r_;
   rec.set_face(r, n_out);
   rec.mat = mat;
-  return true;
 }
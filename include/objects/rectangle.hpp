@@ -43,7 +43,7 @@ class xy_rectangle : public hit<T> {
                const T& y0,
                const T& y1,
                const T& k,
-               std::shared_ptr<material<T>> m)
+               const material<T>* m)
       : mat(m), x0_(x0), x1_(x1), y0_(y0), y1_(y1), k_(k) {}
 
   /**
@@ -52,7 +52,40 @@ class xy_rectangle : public hit<T> {
    * @return true True if the plane is hit
    * @return false False if the plane is not hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal and material of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
+
+  /**
+   * @brief Material of the plane if it emits light
+   *
+   * @return const material<T>* Emissive material, or null
+   */
+  const material<T>* emitter() const override {
+    return mat && mat->emits() ? mat : nullptr;
+  }
+
+  /**
+   * @brief Draw a uniformly distributed point on the plane
+   *
+   */
+  bool sample(const point3<T>&,
+              const T&,
+              const T&,
+              light_sample<T>&) const override;
+
+  /**
+   * @brief Density with which sample draws a point of the plane
+   *
+   */
+  T pdf(const point3<T>&, const point3<T>&) const override;
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -72,7 +105,7 @@ class xy_rectangle : public hit<T> {
    * @brief Material of the object
    *
    */
-  std::shared_ptr<material<T>> mat;
+  const material<T>* mat{nullptr};
   /**
    * @brief X boundaries of plane
    *
@@ -97,15 +130,15 @@ class xy_rectangle : public hit<T> {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of the ray
+ * @param is Closest hit so far
  * @return true True if the plane is hit
  * @return false False if the plane is not hit
  */
 template <typename T>
-bool xy_rectangle<T>::is_hit(const ray<T>& r,
-                             const T& t_min,
-                             const T& t_max,
-                             hit_rec<T>& rec) const {
+bool xy_rectangle<T>::intersect(const ray<T>& r,
+                                const T& t_min,
+                                const T& t_max,
+                                isect<T>& is) const {
   T t = (k_ - r.origin().getZ()) / r.direction().getZ();
   if (t < t_min || t > t_max)
     return false;
@@ -115,15 +148,64 @@ bool xy_rectangle<T>::is_hit(const ray<T>& r,
   if (x < x0_ || x > x1_ || y < y0_ || y > y1_)
     return false;
 
-  rec.u = (x - x0_) / (x1_ - x0_);
-  rec.v = (y - y0_) / (y1_ - y0_);
-  rec.t = t;
+  is.set(this, t, (x - x0_) / (x1_ - x0_), (y - y0_) / (y1_ - y0_));
+  return true;
+}
+
+/**
+ * @brief Fill in the point, normal and material of a hit
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t, u and v already set
+ */
+template <typename T>
+void xy_rectangle<T>::surface(const ray<T>& r,
+                              const isect<T>&,
+                              hit_rec<T>& rec) const {
   vec3<T> n_out = vec3<T>(0, 0, 1);
   rec.set_face(r, n_out);
   rec.mat = mat;
-  rec.p = r.at(t);
+  rec.p = r.at(rec.t);
+}
 
-  return true;
+/**
+ * @brief Draw a uniformly distributed point on the plane
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the plane is seen from
+ * @param a First coordinate of a point of the unit square
+ * @param b Second coordinate of a point of the unit square
+ * @param s Drawn point, with the density seen from o
+ * @return true A point was drawn
+ * @return false The plane is seen edge on
+ */
+template <typename T>
+bool xy_rectangle<T>::sample(const point3<T>& o,
+                             const T& a,
+                             const T& b,
+                             light_sample<T>& s) const {
+  s.u = a;
+  s.v = b;
+  s.p = point3<T>(x0_ + s.u * (x1_ - x0_), y0_ + s.v * (y1_ - y0_), k_);
+  s.n = vec3<T>(0, 0, 1);
+  return area_to_solid_angle(o, (x1_ - x0_) * (y1_ - y0_), s);
+}
+
+/**
+ * @brief Density with which sample draws a point of the plane
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the plane is seen from
+ * @param p Point on the plane
+ * @return T Density per unit solid angle seen from o
+ */
+template <typename T>
+T xy_rectangle<T>::pdf(const point3<T>& o, const point3<T>& p) const {
+  light_sample<T> s;
+  s.p = p;
+  s.n = vec3<T>(0, 0, 1);
+  return area_to_solid_angle(o, (x1_ - x0_) * (y1_ - y0_), s) ? s.pdf : 0;
 }
 
 /**
@@ -154,7 +236,7 @@ class xz_rectangle : public hit<T> {
                const T& z0,
                const T& z1,
                const T& k,
-               std::shared_ptr<material<T>> m)
+               const material<T>* m)
       : mat(m), x0_(x0), x1_(x1), z0_(z0), z1_(z1), k_(k){};
 
   /**
@@ -163,7 +245,40 @@ class xz_rectangle : public hit<T> {
    * @return true True if the plane is hit
    * @return false False if the plane is not hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal and material of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
+
+  /**
+   * @brief Material of the plane if it emits light
+   *
+   * @return const material<T>* Emissive material, or null
+   */
+  const material<T>* emitter() const override {
+    return mat && mat->emits() ? mat : nullptr;
+  }
+
+  /**
+   * @brief Draw a uniformly distributed point on the plane
+   *
+   */
+  bool sample(const point3<T>&,
+              const T&,
+              const T&,
+              light_sample<T>&) const override;
+
+  /**
+   * @brief Density with which sample draws a point of the plane
+   *
+   */
+  T pdf(const point3<T>&, const point3<T>&) const override;
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -183,7 +298,7 @@ class xz_rectangle : public hit<T> {
    * @brief Material of the object
    *
    */
-  std::shared_ptr<material<T>> mat;
+  const material<T>* mat{nullptr};
   /**
    * @brief X boundaries of plane
    *
@@ -208,15 +323,15 @@ class xz_rectangle : public hit<T> {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of the ray
+ * @param is Closest hit so far
  * @return true True if the plane is hit
  * @return false False if the plane is not hit
  */
 template <typename T>
-bool xz_rectangle<T>::is_hit(const ray<T>& r,
-                             const T& t_min,
-                             const T& t_max,
-                             hit_rec<T>& rec) const {
+bool xz_rectangle<T>::intersect(const ray<T>& r,
+                                const T& t_min,
+                                const T& t_max,
+                                isect<T>& is) const {
   T t = (k_ - r.origin().getY()) / r.direction().getY();
   if (t < t_min || t > t_max)
     return false;
@@ -226,15 +341,64 @@ bool xz_rectangle<T>::is_hit(const ray<T>& r,
   if (x < x0_ || x > x1_ || z < z0_ || z > z1_)
     return false;
 
-  rec.u = (x - x0_) / (x1_ - x0_);
-  rec.v = (z - z0_) / (z1_ - z0_);
-  rec.t = t;
+  is.set(this, t, (x - x0_) / (x1_ - x0_), (z - z0_) / (z1_ - z0_));
+  return true;
+}
+
+/**
+ * @brief Fill in the point, normal and material of a hit
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t, u and v already set
+ */
+template <typename T>
+void xz_rectangle<T>::surface(const ray<T>& r,
+                              const isect<T>&,
+                              hit_rec<T>& rec) const {
   vec3<T> n_out = vec3<T>(0, 1, 0);
   rec.set_face(r, n_out);
   rec.mat = mat;
-  rec.p = r.at(t);
+  rec.p = r.at(rec.t);
+}
 
-  return true;
+/**
+ * @brief Draw a uniformly distributed point on the plane
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the plane is seen from
+ * @param a First coordinate of a point of the unit square
+ * @param b Second coordinate of a point of the unit square
+ * @param s Drawn point, with the density seen from o
+ * @return true A point was drawn
+ * @return false The plane is seen edge on
+ */
+template <typename T>
+bool xz_rectangle<T>::sample(const point3<T>& o,
+                             const T& a,
+                             const T& b,
+                             light_sample<T>& s) const {
+  s.u = a;
+  s.v = b;
+  s.p = point3<T>(x0_ + s.u * (x1_ - x0_), k_, z0_ + s.v * (z1_ - z0_));
+  s.n = vec3<T>(0, 1, 0);
+  return area_to_solid_angle(o, (x1_ - x0_) * (z1_ - z0_), s);
+}
+
+/**
+ * @brief Density with which sample draws a point of the plane
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the plane is seen from
+ * @param p Point on the plane
+ * @return T Density per unit solid angle seen from o
+ */
+template <typename T>
+T xz_rectangle<T>::pdf(const point3<T>& o, const point3<T>& p) const {
+  light_sample<T> s;
+  s.p = p;
+  s.n = vec3<T>(0, 1, 0);
+  return area_to_solid_angle(o, (x1_ - x0_) * (z1_ - z0_), s) ? s.pdf : 0;
 }
 
 /**
@@ -265,7 +429,7 @@ class yz_rectangle : public hit<T> {
                const T& z0,
                const T& z1,
                const T& k,
-               std::shared_ptr<material<T>> m)
+               const material<T>* m)
       : mat(m), y0_(y0), y1_(y1), z0_(z0), z1_(z1), k_(k){};
 
   /**
@@ -274,7 +438,40 @@ class yz_rectangle : public hit<T> {
    * @return true True if the plane is hit
    * @return false False if the plane is not hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal and material of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
+
+  /**
+   * @brief Material of the plane if it emits light
+   *
+   * @return const material<T>* Emissive material, or null
+   */
+  const material<T>* emitter() const override {
+    return mat && mat->emits() ? mat : nullptr;
+  }
+
+  /**
+   * @brief Draw a uniformly distributed point on the plane
+   *
+   */
+  bool sample(const point3<T>&,
+              const T&,
+              const T&,
+              light_sample<T>&) const override;
+
+  /**
+   * @brief Density with which sample draws a point of the plane
+   *
+   */
+  T pdf(const point3<T>&, const point3<T>&) const override;
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -294,7 +491,7 @@ class yz_rectangle : public hit<T> {
    * @brief Material of the object
    *
    */
-  std::shared_ptr<material<T>> mat;
+  const material<T>* mat{nullptr};
   /**
    * @brief Y boundaries of plane
    *
@@ -319,15 +516,15 @@ class yz_rectangle : public hit<T> {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of the ray
+ * @param is Closest hit so far
  * @return true True if the plane is hit
  * @return false False if the plane is not hit
  */
 template <typename T>
-bool yz_rectangle<T>::is_hit(const ray<T>& r,
-                             const T& t_min,
-                             const T& t_max,
-                             hit_rec<T>& rec) const {
+bool yz_rectangle<T>::intersect(const ray<T>& r,
+                                const T& t_min,
+                                const T& t_max,
+                                isect<T>& is) const {
   T t = (k_ - r.origin().getX()) / r.direction().getX();
   if (t < t_min || t > t_max)
     return false;
@@ -337,13 +534,62 @@ bool yz_rectangle<T>::is_hit(const ray<T>& r,
   if (y < y0_ || y > y1_ || z < z0_ || z > z1_)
     return false;
 
-  rec.u = (y - y0_) / (y1_ - y0_);
-  rec.v = (z - z0_) / (z1_ - z0_);
-  rec.t = t;
+  is.set(this, t, (y - y0_) / (y1_ - y0_), (z - z0_) / (z1_ - z0_));
+  return true;
+}
+
+/**
+ * @brief Fill in the point, normal and material of a hit
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t, u and v already set
+ */
+template <typename T>
+void yz_rectangle<T>::surface(const ray<T>& r,
+                              const isect<T>&,
+                              hit_rec<T>& rec) const {
   vec3<T> n_out = vec3<T>(1, 0, 0);
   rec.set_face(r, n_out);
   rec.mat = mat;
-  rec.p = r.at(t);
+  rec.p = r.at(rec.t);
+}
 
-  return true;
+/**
+ * @brief Draw a uniformly distributed point on the plane
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the plane is seen from
+ * @param a First coordinate of a point of the unit square
+ * @param b Second coordinate of a point of the unit square
+ * @param s Drawn point, with the density seen from o
+ * @return true A point was drawn
+ * @return false The plane is seen edge on
+ */
+template <typename T>
+bool yz_rectangle<T>::sample(const point3<T>& o,
+                             const T& a,
+                             const T& b,
+                             light_sample<T>& s) const {
+  s.u = a;
+  s.v = b;
+  s.p = point3<T>(k_, y0_ + s.u * (y1_ - y0_), z0_ + s.v * (z1_ - z0_));
+  s.n = vec3<T>(1, 0, 0);
+  return area_to_solid_angle(o, (y1_ - y0_) * (z1_ - z0_), s);
+}
+
+/**
+ * @brief Density with which sample draws a point of the plane
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the plane is seen from
+ * @param p Point on the plane
+ * @return T Density per unit solid angle seen from o
+ */
+template <typename T>
+T yz_rectangle<T>::pdf(const point3<T>& o, const point3<T>& p) const {
+  light_sample<T> s;
+  s.p = p;
+  s.n = vec3<T>(1, 0, 0);
+  return area_to_solid_angle(o, (y1_ - y0_) * (z1_ - z0_), s) ? s.pdf : 0;
 }
@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+
 #include "hit.hpp"
 
 // Subclass of hit: sphere
@@ -34,7 +37,7 @@ class sphere : public hit<T> {
    * @param r Radius of sphere
    * @param m Material of sphere
    */
-  sphere(const point3<T>& cen, const T& r, std::shared_ptr<material<T>> m)
+  sphere(const point3<T>& cen, const T& r, const material<T>* m)
       : mat(m), c_(cen), r_(r) {}
 
   /**
@@ -57,7 +60,40 @@ class sphere : public hit<T> {
    * @return true True if the sphere is hit
    * @return false False if the sphere is not hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal, material and uv of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
+
+  /**
+   * @brief Material of the sphere if it emits light
+   *
+   * @return const material<T>* Emissive material, or null
+   */
+  const material<T>* emitter() const override {
+    return mat && mat->emits() ? mat : nullptr;
+  }
+
+  /**
+   * @brief Draw a point on the sphere within the cone it fills seen from o
+   *
+   */
+  bool sample(const point3<T>&,
+              const T&,
+              const T&,
+              light_sample<T>&) const override;
+
+  /**
+   * @brief Density with which sample draws a point of the sphere
+   *
+   */
+  T pdf(const point3<T>&, const point3<T>&) const override;
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -76,7 +112,7 @@ class sphere : public hit<T> {
    * @brief Material of the sphere
    *
    */
-  std::shared_ptr<material<T>> mat;
+  const material<T>* mat{nullptr};
   /**
    * @brief Center of the sphere
    *
@@ -111,15 +147,15 @@ class sphere : public hit<T> {
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of the ray
+ * @param is Closest hit so far
  * @return true True if the sphere is hit
  * @return false False if the sphere is not hit
  */
 template <typename T>
-bool sphere<T>::is_hit(const ray<T>& r,
-                       const T& t_min,
-                       const T& t_max,
-                       hit_rec<T>& rec) const {
+bool sphere<T>::intersect(const ray<T>& r,
+                          const T& t_min,
+                          const T& t_max,
+                          isect<T>& is) const {
   // Ray from origin to center of sphere
   vec3<T> oc = r.origin() - c_;
 
@@ -143,11 +179,109 @@ bool sphere<T>::is_hit(const ray<T>& r,
       return false;
   }
 
-  rec.t = soln;
+  is.set(this, soln);
+  return true;
+}
+
+/**
+ * @brief Fill in the point, normal, material and uv of a hit
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t already set
+ */
+template <typename T>
+void sphere<T>::surface(const ray<T>& r,
+                        const isect<T>&,
+                        hit_rec<T>& rec) const {
   rec.p = r.at(rec.t);
   vec3<T> n_out = (rec.p - c_) / r_;
   rec.set_face(r, n_out);
   rec.mat = mat;
   get_sph_uv(n_out, rec.u, rec.v);
+}
+
+/**
+ * @brief Draw a point on the sphere within the cone it fills seen from o
+ * @details Directions are drawn uniformly in the cone around the center, so
+ * only the visible cap is ever sampled. From inside the sphere the whole
+ * surface is visible and points are drawn uniformly over its area.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the sphere is seen from
+ * @param u1 First coordinate of a point of the unit square, mapped to the
+ * angle off the center
+ * @param u2 Second coordinate, mapped to the angle around the center
+ * @param s Drawn point, with the density seen from o
+ * @return true A point was drawn
+ * @return false No point could be drawn
+ */
+template <typename T>
+bool sphere<T>::sample(const point3<T>& o,
+                       const T& u1,
+                       const T& u2,
+                       light_sample<T>& s) const {
+  const vec3<T> w = c_ - o;
+  const T d2 = w.norm_sqr();
+  const T r2 = r_ * r_;
+
+  if (d2 <= r2) {
+    s.n = sphere_point(u1, u2);
+    s.p = c_ + r_ * s.n;
+    get_sph_uv(s.n, s.u, s.v);
+    return area_to_solid_angle(o, static_cast<T>(4 * M_PI) * r2, s);
+  }
+
+  const T cos_max = std::sqrt(std::max(static_cast<T>(0), 1 - r2 / d2));
+  const T solid = static_cast<T>(2 * M_PI) * (1 - cos_max);
+  if (!(solid > 0))
+    return false;
+  const T cos_t = 1 - u1 * (1 - cos_max);
+  const T sin_t = std::sqrt(std::max(static_cast<T>(0), 1 - cos_t * cos_t));
+  const T phi = static_cast<T>(2 * M_PI) * u2;
+
+  // Frame around the direction to the center
+  const vec3<T> z = w / std::sqrt(d2);
+  const vec3<T> a = std::fabs(z[0]) > static_cast<T>(0.9) ? vec3<T>(0, 1, 0)
+                                                          : vec3<T>(1, 0, 0);
+  const vec3<T> x = unit_v(cross(z, a));
+  const vec3<T> y = cross(z, x);
+  const vec3<T> dir =
+      sin_t * std::cos(phi) * x + sin_t * std::sin(phi) * y + cos_t * z;
+
+  // Nearest point of the sphere along the drawn direction
+  const T b = dot(w, dir);
+  const T t = b - std::sqrt(std::max(static_cast<T>(0), r2 - (d2 - b * b)));
+  s.p = o + t * dir;
+  s.n = (s.p - c_) / r_;
+  get_sph_uv(s.n, s.u, s.v);
+  s.pdf = 1 / solid;
   return true;
 }
+
+/**
+ * @brief Density with which sample draws a point of the sphere
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param o Point the sphere is seen from
+ * @param p Point on the sphere
+ * @return T Density per unit solid angle seen from o
+ */
+template <typename T>
+T sphere<T>::pdf(const point3<T>& o, const point3<T>& p) const {
+  const T d2 = (c_ - o).norm_sqr();
+  const T r2 = r_ * r_;
+
+  if (d2 <= r2) {
+    light_sample<T> s;
+    s.p = p;
+    s.n = (p - c_) / r_;
+    return area_to_solid_angle(o, static_cast<T>(4 * M_PI) * r2, s) ? s.pdf
+                                                                     : 0;
+  }
+
+  // Every direction in the cone is equally likely
+  const T cos_max = std::sqrt(std::max(static_cast<T>(0), 1 - r2 / d2));
+  const T solid = static_cast<T>(2 * M_PI) * (1 - cos_max);
+  return solid > 0 ? 1 / solid : 0;
+}
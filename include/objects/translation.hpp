@@ -32,8 +32,8 @@ class translate : public hit<T> {
    * @param p Object to translate
    * @param disp Translation vector
    */
-  translate(std::shared_ptr<hit<T>> p, const vec3<T>& disp)
-      : p_(p), disp_(disp) {}
+  translate(const hit<T>* p, const vec3<T>& disp)
+      : p_(p), disp_(disp), depth_(wrapped_depth(p)) {}
 
   /**
    * @brief Returns whether a ray intersects the translated objected
@@ -41,24 +41,63 @@ class translate : public hit<T> {
    * @param r Ray to compute
    * @param t_min Initial shutter time
    * @param t_max Final shutter time
-   * @param rec Hit record of the ray
+   * @param is Closest hit so far
    * @return true True if the translated object is hit
    * @return false False if the translated object is not hit
    */
-  bool is_hit(const ray<T>& r,
-              const T& t_min,
-              const T& t_max,
-              hit_rec<T>& rec) const override {
-    ray<T> trans_r(r.origin() - disp_, r.direction(), r.time());
-    if (!p_->is_hit(trans_r, t_min, t_max, rec))
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override {
+    if (!p_->intersect(to_local(r), t_min, t_max, is))
       return false;
+    is.push(this);
+    return true;
+  }
 
+  /**
+   * @brief Whether the translated object blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True if the translated object is hit
+   * @return false False if the translated object is not hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    return p_->occluded(to_local(r), t_min, t_max);
+  }
+
+  /**
+   * @brief Move a ray into the object's frame
+   *
+   * @param r Ray to move
+   * @return ray<T> Moved ray
+   */
+  ray<T> to_local(const ray<T>& r) const override {
+    return ray<T>(r.origin() - disp_, r.direction(), r.time());
+  }
+
+  /**
+   * @brief Move a hit back out of the object's frame
+   *
+   * @param trans_r Moved ray the hit was found with
+   * @param rec Hit record to move
+   */
+  void to_world(const ray<T>& trans_r, hit_rec<T>& rec) const override {
     rec.p += disp_;
     rec.set_face(trans_r, rec.n);
-
-    return true;
   }
 
+  /**
+   * @brief Return the nesting of transform wrappers, this one included
+   *
+   * @return int Wrapper depth
+   */
+  int wrap_depth() const override { return depth_; }
+
   /**
    * @brief Returns whether we are in the bounding box
    *
@@ -79,10 +118,15 @@ class translate : public hit<T> {
    * @brief Object to translate
    *
    */
-  std::shared_ptr<hit<T>> p_;
+  const hit<T>* p_{nullptr};
   /**
    * @brief Translation vector
    *
    */
   vec3<T> disp_;
+  /**
+   * @brief Wrapper depth, this one included
+   *
+   */
+  int depth_{0};
 };
@@ -0,0 +1,427 @@
+/**
+ * @file tri_batch.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Triangles packed in SIMD-width batches for BVH leaves
+ * @details Each batch holds tri_lanes triangles in structure-of-arrays
+ * layout: the first corner and the two precomputed edges, in float, so one
+ * ray is tested against a whole batch with Möller–Trumbore at once. The
+ * kernel is compiled with AVX (8 lanes) or SSE (4 lanes) when the compiler
+ * targets them, and with plain loops over 4 lanes otherwise. Only t, u, v
+ * and the triangle's index come out; the caller computes the normal once,
+ * for the closest hit.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "linear_bvh.hpp"
+
+#if defined(__AVX__)
+/**
+ * @brief 8 float lanes with AVX
+ *
+ */
+struct simd_lanes {
+  using v = __m256;
+  static constexpr int width = 8;
+  static v load(const float* p) { return _mm256_load_ps(p); }
+  static void store(float* p, v a) { _mm256_store_ps(p, a); }
+  static v set(float x) { return _mm256_set1_ps(x); }
+  static v add(v a, v b) { return _mm256_add_ps(a, b); }
+  static v sub(v a, v b) { return _mm256_sub_ps(a, b); }
+  static v mul(v a, v b) { return _mm256_mul_ps(a, b); }
+  static v div(v a, v b) { return _mm256_div_ps(a, b); }
+  static v ge(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+  static v le(v a, v b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  static v both(v a, v b) { return _mm256_and_ps(a, b); }
+  static v abs(v a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+  static int mask(v a) { return _mm256_movemask_ps(a); }
+};
+#elif defined(__SSE2__)
+/**
+ * @brief 4 float lanes with SSE
+ *
+ */
+struct simd_lanes {
+  using v = __m128;
+  static constexpr int width = 4;
+  static v load(const float* p) { return _mm_load_ps(p); }
+  static void store(float* p, v a) { _mm_store_ps(p, a); }
+  static v set(float x) { return _mm_set1_ps(x); }
+  static v add(v a, v b) { return _mm_add_ps(a, b); }
+  static v sub(v a, v b) { return _mm_sub_ps(a, b); }
+  static v mul(v a, v b) { return _mm_mul_ps(a, b); }
+  static v div(v a, v b) { return _mm_div_ps(a, b); }
+  static v ge(v a, v b) { return _mm_cmpge_ps(a, b); }
+  static v le(v a, v b) { return _mm_cmple_ps(a, b); }
+  static v both(v a, v b) { return _mm_and_ps(a, b); }
+  static v abs(v a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+  static int mask(v a) { return _mm_movemask_ps(a); }
+};
+#else
+/**
+ * @brief 4 float lanes emulated with loops, masks are 0 or 1
+ *
+ */
+struct simd_lanes {
+  static constexpr int width = 4;
+  struct v {
+    float x[width];
+  };
+  template <typename F>
+  static v map(v a, v b, F f) {
+    v r;
+    for (int i = 0; i < width; i++)
+      r.x[i] = f(a.x[i], b.x[i]);
+    return r;
+  }
+  static v load(const float* p) {
+    v r;
+    std::copy(p, p + width, r.x);
+    return r;
+  }
+  static void store(float* p, v a) { std::copy(a.x, a.x + width, p); }
+  static v set(float x) {
+    v r;
+    std::fill(r.x, r.x + width, x);
+    return r;
+  }
+  static v add(v a, v b) {
+    return map(a, b, [](float x, float y) { return x + y; });
+  }
+  static v sub(v a, v b) {
+    return map(a, b, [](float x, float y) { return x - y; });
+  }
+  static v mul(v a, v b) {
+    return map(a, b, [](float x, float y) { return x * y; });
+  }
+  static v div(v a, v b) {
+    return map(a, b, [](float x, float y) { return x / y; });
+  }
+  static v ge(v a, v b) {
+    return map(a, b, [](float x, float y) -> float { return x >= y; });
+  }
+  static v le(v a, v b) {
+    return map(a, b, [](float x, float y) -> float { return x <= y; });
+  }
+  static v both(v a, v b) {
+    return map(a, b, [](float x, float y) -> float { return x && y; });
+  }
+  static v abs(v a) {
+    return map(a, a, [](float x, float) { return std::fabs(x); });
+  }
+  static int mask(v a) {
+    int m = 0;
+    for (int i = 0; i < width; i++)
+      m |= (a.x[i] != 0) << i;
+    return m;
+  }
+};
+#endif
+
+/**
+ * @brief Number of triangles in a batch
+ *
+ */
+constexpr int tri_lanes = simd_lanes::width;
+
+/**
+ * @brief tri_lanes triangles in structure-of-arrays layout
+ * @details Unused lanes have zero edges, which the kernel rejects as
+ * degenerate.
+ *
+ */
+struct alignas(32) tri_batch {
+  /**
+   * @brief First corner, per axis and lane
+   *
+   */
+  float v0[3][tri_lanes];
+  /**
+   * @brief Edges v1 - v0 and v2 - v0, per axis and lane
+   *
+   */
+  float e1[3][tri_lanes], e2[3][tri_lanes];
+  /**
+   * @brief Index of the triangle in each lane, UINT32_MAX when unused
+   *
+   */
+  uint32_t id[tri_lanes];
+};
+
+/**
+ * @brief Ray in float, set up once per traversal
+ *
+ */
+struct tri_ray {
+  float o[3], d[3];
+};
+
+/**
+ * @brief Intersect a ray with every triangle of a batch
+ * @details Same tests and epsilon as intersect_edges, evaluated on every
+ * lane at once.
+ *
+ * @param b Batch of triangles
+ * @param r Ray to compute
+ * @param t_min Initial shutter time
+ * @param t_max Final shutter time
+ * @param t Distance of each lane's hit
+ * @param u Barycentric coordinate of v1 of each lane's hit
+ * @param v Barycentric coordinate of v2 of each lane's hit
+ * @return int Bit mask of the lanes that were hit
+ */
+inline int intersect_batch(const tri_batch& b,
+                           const tri_ray& r,
+                           float t_min,
+                           float t_max,
+                           float* t,
+                           float* u,
+                           float* v) {
+  using S = simd_lanes;
+  using V = S::v;
+  const V dx = S::set(r.d[0]), dy = S::set(r.d[1]), dz = S::set(r.d[2]);
+  const V e1x = S::load(b.e1[0]), e1y = S::load(b.e1[1]),
+          e1z = S::load(b.e1[2]);
+  const V e2x = S::load(b.e2[0]), e2y = S::load(b.e2[1]),
+          e2z = S::load(b.e2[2]);
+
+  // h = d x e2, a = e1 . h
+  const V hx = S::sub(S::mul(dy, e2z), S::mul(dz, e2y));
+  const V hy = S::sub(S::mul(dz, e2x), S::mul(dx, e2z));
+  const V hz = S::sub(S::mul(dx, e2y), S::mul(dy, e2x));
+  const V a =
+      S::add(S::add(S::mul(e1x, hx), S::mul(e1y, hy)), S::mul(e1z, hz));
+  V m = S::ge(S::abs(a), S::set(0.000001f));
+  if (!S::mask(m))
+    return 0;
+  const V f = S::div(S::set(1.0f), a);
+
+  // s = o - v0, u = f (s . h)
+  const V sx = S::sub(S::set(r.o[0]), S::load(b.v0[0]));
+  const V sy = S::sub(S::set(r.o[1]), S::load(b.v0[1]));
+  const V sz = S::sub(S::set(r.o[2]), S::load(b.v0[2]));
+  const V uu = S::mul(
+      f, S::add(S::add(S::mul(sx, hx), S::mul(sy, hy)), S::mul(sz, hz)));
+  const V zero = S::set(0.0f), one = S::set(1.0f);
+  m = S::both(m, S::both(S::ge(uu, zero), S::le(uu, one)));
+
+  // q = s x e1, v = f (d . q), t = f (e2 . q)
+  const V qx = S::sub(S::mul(sy, e1z), S::mul(sz, e1y));
+  const V qy = S::sub(S::mul(sz, e1x), S::mul(sx, e1z));
+  const V qz = S::sub(S::mul(sx, e1y), S::mul(sy, e1x));
+  const V vv = S::mul(
+      f, S::add(S::add(S::mul(dx, qx), S::mul(dy, qy)), S::mul(dz, qz)));
+  m = S::both(m, S::both(S::ge(vv, zero), S::le(S::add(uu, vv), one)));
+  const V tt = S::mul(
+      f, S::add(S::add(S::mul(e2x, qx), S::mul(e2y, qy)), S::mul(e2z, qz)));
+  m = S::both(m, S::both(S::ge(tt, S::set(t_min)), S::le(tt, S::set(t_max))));
+
+  S::store(t, tt);
+  S::store(u, uu);
+  S::store(v, vv);
+  return S::mask(m);
+}
+
+/**
+ * @brief Triangles of a BVH's leaves packed into batches
+ * @details Every leaf gets its own run of batches, so a leaf of n triangles
+ * is tested with ceil(n / tri_lanes) kernel calls. first_ maps the first
+ * triangle of each leaf to the first batch of its run.
+ *
+ */
+class tri_batches {
+ public:
+  /**
+   * @brief Pack the triangles of every leaf of a tree
+   *
+   * @tparam T Datatype to be used (e.g float, double)
+   * @param verts Vertex positions
+   * @param ids Three vertex indices per triangle, in leaf order
+   * @param n Number of triangles
+   * @param tree BVH whose leaves index the triangles
+   */
+  template <typename T>
+  void build(const point3<T>* verts,
+             const uint32_t* ids,
+             size_t n,
+             const flat_bvh<T>& tree) {
+    own_.clear();
+    own_first_.assign(n, 0);
+    const lbvh_node* nodes = tree.data();
+    for (size_t i = 0; i < tree.size(); i++) {
+      const lbvh_node& nd = nodes[i];
+      if (nd.count == 0)
+        continue;
+      own_first_[nd.offset] = static_cast<uint32_t>(own_.size());
+      for (uint32_t k = 0; k < nd.count; k += tri_lanes) {
+        tri_batch b = {};
+        for (int l = 0; l < tri_lanes; l++) {
+          b.id[l] = UINT32_MAX;
+          if (k + l >= nd.count)
+            continue;
+          const uint32_t tri = nd.offset + k + l;
+          const uint32_t* f = &ids[3 * static_cast<size_t>(tri)];
+          const vec3<T> e1 = verts[f[1]] - verts[f[0]];
+          const vec3<T> e2 = verts[f[2]] - verts[f[0]];
+          for (int a = 0; a < 3; a++) {
+            b.v0[a][l] = static_cast<float>(verts[f[0]][a]);
+            b.e1[a][l] = static_cast<float>(e1[a]);
+            b.e2[a][l] = static_cast<float>(e2[a]);
+          }
+          b.id[l] = tri;
+        }
+        own_.push_back(b);
+      }
+    }
+    batch_ = own_.data();
+    first_ = own_first_.data();
+    batches_ = own_.size();
+    tris_ = n;
+  }
+
+  /**
+   * @brief Use batches held elsewhere instead of packing them
+   *
+   * @param batches First batch
+   * @param count Number of batches
+   * @param first First batch of each leaf, by first triangle of the leaf
+   * @param n Number of triangles
+   */
+  void view(const tri_batch* batches,
+            size_t count,
+            const uint32_t* first,
+            size_t n) {
+    own_.clear();
+    own_first_.clear();
+    batch_ = batches;
+    first_ = first;
+    batches_ = count;
+    tris_ = n;
+  }
+
+  /**
+   * @brief Return the batches
+   *
+   * @return const tri_batch* First batch
+   */
+  const tri_batch* data() const { return batch_; }
+  /**
+   * @brief Return the number of batches
+   *
+   * @return size_t Number of batches
+   */
+  size_t size() const { return batches_; }
+  /**
+   * @brief Return the first batch of each leaf, by first triangle
+   *
+   * @return const uint32_t* One entry per triangle
+   */
+  const uint32_t* first() const { return first_; }
+  /**
+   * @brief Return the memory held by the batches and the leaf map
+   *
+   * @return size_t Size in bytes
+   */
+  size_t bytes() const {
+    return batches_ * sizeof(tri_batch) + tris_ * sizeof(uint32_t);
+  }
+
+  /**
+   * @brief Find the closest hit among the triangles of a leaf
+   *
+   * @param r Ray to compute
+   * @param first First triangle of the leaf
+   * @param count Number of triangles in the leaf
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time, lowered to the closest hit
+   * @param id Index of the closest triangle hit
+   * @param u Barycentric coordinate of v1 of the hit
+   * @param v Barycentric coordinate of v2 of the hit
+   * @return true True if a triangle closer than t_max is hit
+   * @return false False if no triangle is hit
+   */
+  bool intersect(const tri_ray& r,
+                 uint32_t first,
+                 uint16_t count,
+                 float t_min,
+                 float& t_max,
+                 uint32_t& id,
+                 float& u,
+                 float& v) const {
+    alignas(32) float tt[tri_lanes], uu[tri_lanes], vv[tri_lanes];
+    const tri_batch* b = batch_ + first_[first];
+    const tri_batch* end = b + (count + tri_lanes - 1) / tri_lanes;
+    bool found = false;
+    for (; b != end; ++b) {
+      int m = intersect_batch(*b, r, t_min, t_max, tt, uu, vv);
+      for (int l = 0; m; l++, m >>= 1) {
+        if ((m & 1) && tt[l] <= t_max) {
+          found = true;
+          t_max = tt[l];
+          id = b->id[l];
+          u = uu[l];
+          v = vv[l];
+        }
+      }
+    }
+    return found;
+  }
+
+  /**
+   * @brief Whether any triangle of a leaf is hit in [t_min, t_max]
+   *
+   * @param r Ray to compute
+   * @param first First triangle of the leaf
+   * @param count Number of triangles in the leaf
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True as soon as one triangle is hit
+   * @return false False if no triangle is hit
+   */
+  bool any(const tri_ray& r,
+           uint32_t first,
+           uint16_t count,
+           float t_min,
+           float t_max) const {
+    alignas(32) float tt[tri_lanes], uu[tri_lanes], vv[tri_lanes];
+    const tri_batch* b = batch_ + first_[first];
+    const tri_batch* end = b + (count + tri_lanes - 1) / tri_lanes;
+    for (; b != end; ++b)
+      if (intersect_batch(*b, r, t_min, t_max, tt, uu, vv))
+        return true;
+    return false;
+  }
+
+ private:
+  /**
+   * @brief Batches and leaf map owned by this object when not viewed
+   *
+   */
+  std::vector<tri_batch> own_;
+  std::vector<uint32_t> own_first_;
+  /**
+   * @brief Batches and leaf map in use
+   *
+   */
+  const tri_batch* batch_{nullptr};
+  const uint32_t* first_{nullptr};
+  /**
+   * @brief Number of batches and of triangles
+   *
+   */
+  size_t batches_{0}, tris_{0};
+};
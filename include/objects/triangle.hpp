@@ -30,8 +30,8 @@ class triangle : public hit<T> {
            const point3<T>& v1,
            const point3<T>& v2,
            const T& k,
-           std::shared_ptr<material<T>> m)
-      : mat(m), v0_(v0), v1_(v1), v2_(v2), k_(k) {}
+           const material<T>* m)
+      : mat(m), v0_(v0), e1_(v1 - v0), e2_(v2 - v0), k_(k) {}
 
   /**
    * @brief Returns whether a ray intersects the triangle
@@ -39,7 +39,16 @@ class triangle : public hit<T> {
    * @return true True if the plane is hit
    * @return false False if the plane is not hit
    */
-  bool is_hit(const ray<T>&, const T&, const T&, hit_rec<T>&) const override;
+  bool intersect(const ray<T>&,
+                 const T&,
+                 const T&,
+                 isect<T>&) const override;
+
+  /**
+   * @brief Fill in the point, normal and material of a hit
+   *
+   */
+  void surface(const ray<T>&, const isect<T>&, hit_rec<T>&) const override;
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -49,12 +58,14 @@ class triangle : public hit<T> {
    * @return false Never returns false
    */
   bool bound_box(const T&, const T&, BB<T>& out) const override {
-    out = BB<T>(point3<T>(std::min<T>({v0_.getX(), v1_.getX(), v2_.getX()}),
-                          std::min<T>({v0_.getY(), v1_.getY(), v2_.getY()}),
-                          std::min<T>({v0_.getZ(), v1_.getZ(), v2_.getZ()})),
-                point3<T>(std::max<T>({v0_.getX(), v1_.getX(), v2_.getX()}),
-                          std::max<T>({v0_.getY(), v1_.getY(), v2_.getY()}),
-                          std::max<T>({v0_.getZ(), v1_.getZ(), v2_.getZ()})));
+    const point3<T> v1 = v0_ + e1_;
+    const point3<T> v2 = v0_ + e2_;
+    out = BB<T>(point3<T>(std::min<T>({v0_.getX(), v1.getX(), v2.getX()}),
+                          std::min<T>({v0_.getY(), v1.getY(), v2.getY()}),
+                          std::min<T>({v0_.getZ(), v1.getZ(), v2.getZ()})),
+                point3<T>(std::max<T>({v0_.getX(), v1.getX(), v2.getX()}),
+                          std::max<T>({v0_.getY(), v1.getY(), v2.getY()}),
+                          std::max<T>({v0_.getZ(), v1.getZ(), v2.getZ()})));
     return true;
   }
 
@@ -63,46 +74,57 @@ class triangle : public hit<T> {
    * @brief Material of the object
    *
    */
-  std::shared_ptr<material<T>> mat;
+  const material<T>* mat{nullptr};
   /**
-   * @brief Vertices of triangle
+   * @brief First vertex of the triangle
    *
    */
-  point3<T> v0_, v1_, v2_;
+  point3<T> v0_;
+  /**
+   * @brief Edges to the second and third vertex, precomputed for is_hit
+   *
+   */
+  vec3<T> e1_, e2_;
   T k_;
 };
 
 /**
- * @brief Returns whether a ray intersects the triangle:
+ * @brief Intersect a ray with a triangle given by a corner and two edges:
  * https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
  *
  * @tparam T Datatype to be used (e.g float, double)
+ * @param v0 First corner
+ * @param e1 Edge from the first to the second corner
+ * @param e2 Edge from the first to the third corner
  * @param r Ray to compute
  * @param t_min Initial shutter time
  * @param t_max Final shutter time
- * @param rec Hit record of the ray
- * @return true True if the plane is hit
- * @return false False if the plane is not hit
+ * @param t Distance along the ray of the hit
+ * @param u Barycentric coordinate of the second corner
+ * @param v Barycentric coordinate of the third corner
+ * @return true True if the triangle is hit
+ * @return false False if the triangle is not hit
  */
 template <typename T>
-bool triangle<T>::is_hit(const ray<T>& r,
-                         const T& t_min,
-                         const T& t_max,
-                         hit_rec<T>& rec) const {
-  T u, v, t;
-
-  vec3<T> e1, e2, h, s, q;
+inline bool intersect_edges(const point3<T>& v0,
+                            const vec3<T>& e1,
+                            const vec3<T>& e2,
+                            const ray<T>& r,
+                            const T& t_min,
+                            const T& t_max,
+                            T& t,
+                            T& u,
+                            T& v) {
+  vec3<T> h, s, q;
   T a, f;
 
-  e1 = v1_ - v0_;
-  e2 = v2_ - v0_;
   h = cross(r.direction(), e2);
   a = dot(e1, h);
 
   if (fabs(a) < 0.000001)
     return false;
   f = 1.0 / a;
-  s = r.origin() - v0_;
+  s = r.origin() - v0;
   u = f * dot(s, h);
   if (u < 0.0 || u > 1.0)
     return false;
@@ -115,13 +137,75 @@ bool triangle<T>::is_hit(const ray<T>& r,
   t = f * dot(e2, q);
   if (t < t_min || t > t_max)
     return false;
-  rec.u = u;
-  rec.v = v;
-  rec.t = t;
-  vec3<T> n_out = unit_v(cross(e1, e2));
-  rec.set_face(r, n_out);
-  rec.mat = mat;
-  rec.p = r.at(t);
+  return true;
+}
+
+/**
+ * @brief Intersect a ray with a triangle given by its corners
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param v0 First corner
+ * @param v1 Second corner
+ * @param v2 Third corner
+ * @param r Ray to compute
+ * @param t_min Initial shutter time
+ * @param t_max Final shutter time
+ * @param t Distance along the ray of the hit
+ * @param u Barycentric coordinate of v1
+ * @param v Barycentric coordinate of v2
+ * @return true True if the triangle is hit
+ * @return false False if the triangle is not hit
+ */
+template <typename T>
+inline bool intersect_triangle(const point3<T>& v0,
+                               const point3<T>& v1,
+                               const point3<T>& v2,
+                               const ray<T>& r,
+                               const T& t_min,
+                               const T& t_max,
+                               T& t,
+                               T& u,
+                               T& v) {
+  return intersect_edges(v0, v1 - v0, v2 - v0, r, t_min, t_max, t, u, v);
+}
+
+/**
+ * @brief Returns whether a ray intersects the triangle
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray to compute
+ * @param t_min Initial shutter time
+ * @param t_max Final shutter time
+ * @param is Closest hit so far
+ * @return true True if the plane is hit
+ * @return false False if the plane is not hit
+ */
+template <typename T>
+bool triangle<T>::intersect(const ray<T>& r,
+                            const T& t_min,
+                            const T& t_max,
+                            isect<T>& is) const {
+  T u, v, t;
+  if (!intersect_edges(v0_, e1_, e2_, r, t_min, t_max, t, u, v))
+    return false;
 
+  is.set(this, t, u, v);
   return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Fill in the point, normal and material of a hit
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray the hit was found with
+ * @param rec Hit record, with t, u and v already set
+ */
+template <typename T>
+void triangle<T>::surface(const ray<T>& r,
+                          const isect<T>&,
+                          hit_rec<T>& rec) const {
+  vec3<T> n_out = unit_v(cross(e1_, e2_));
+  rec.set_face(r, n_out);
+  rec.mat = mat;
+  rec.p = r.at(rec.t);
+}
@@ -31,7 +31,7 @@ class x_rotation : public hit<T> {
    * @param p Object to rotate
    * @param t_deg Angle of rotation in degrees
    */
-  x_rotation(std::shared_ptr<hit<T>> p, const T& t_deg);
+  x_rotation(const hit<T>* p, const T& t_deg);
 
   /**
    * @brief Returns whether a ray intersects the rotated objected
@@ -39,14 +39,52 @@ class x_rotation : public hit<T> {
    * @param r Ray to compute
    * @param t_min Initial shutter time
    * @param t_max Final shutter time
-   * @param rec Hit record of the ray
+   * @param is Closest hit so far
    * @return true True if the rotated object is hit
    * @return false False if the rotated object is not hit
    */
-  bool is_hit(const ray<T>& r,
-              const T& t_min,
-              const T& t_max,
-              hit_rec<T>& out) const override;
+  bool intersect(const ray<T>& r,
+                 const T& t_min,
+                 const T& t_max,
+                 isect<T>& is) const override;
+
+  /**
+   * @brief Whether the rotated object blocks the ray
+   *
+   * @param r Ray to compute
+   * @param t_min Initial shutter time
+   * @param t_max Final shutter time
+   * @return true True if the rotated object is hit
+   * @return false False if the rotated object is not hit
+   */
+  bool occluded(const ray<T>& r,
+                const T& t_min,
+                const T& t_max) const override {
+    return p_->occluded(to_local(r), t_min, t_max);
+  }
+
+  /**
+   * @brief Rotate a ray into the object's frame
+   *
+   * @param r Ray to rotate
+   * @return ray<T> Rotated ray
+   */
+  ray<T> to_local(const ray<T>& r) const override;
+
+  /**
+   * @brief Rotate a hit back out of the object's frame
+   *
+   * @param rot_r Rotated ray the hit was found with
+   * @param rec Hit record to rotate
+   */
+  void to_world(const ray<T>& rot_r, hit_rec<T>& rec) const override;
+
+  /**
+   * @brief Return the nesting of transform wrappers, this one included
+   *
+   * @return int Wrapper depth
+   */
+  int wrap_depth() const override { return depth_; }
 
   /**
    * @brief Returns whether we are in the bounding box
@@ -65,7 +103,7 @@ class x_rotation : public hit<T> {
    * @brief Object to rotate
    *
    */
-  std::shared_ptr<hit<T>> p_;
+  const hit<T>* p_{nullptr};
   /**
    * @brief Sine and cosine of the angle
    *
@@ -81,6 +119,11 @@ class x_rotation : public hit<T> {
    *
    */
   BB<T> bound_;
+  /**
+   * @brief Wrapper depth, this one included
+   *
+   */
+  int depth_{0};
 };
 
 /**
@@ -94,7 +137,8 @@ class x_rotation : public hit<T> {
  * @param t_deg Angle of rotation in degrees
  */
 template <typename T>
-x_rotation<T>::x_rotation(std::shared_ptr<hit<T>> p, const T& t_deg) : p_(p) {
+x_rotation<T>::x_rotation(const hit<T>* p, const T& t_deg)
+    : p_(p), depth_(wrapped_depth(p)) {
   T t_rad = deg_to_rad(t_deg);
   sin_t = std::sin(t_rad);
   cos_t = std::cos(t_rad);
@@ -127,21 +171,14 @@ x_rotation<T>::x_rotation(std::shared_ptr<hit<T>> p, const T& t_deg) : p_(p) {
 }
 
 /**
- * @brief
+ * @brief Rotate a ray into the object's frame
  *
  * @tparam T Datatype to use (e.g float, double)
- * @param r Ray to compute
- * @param t_min Initial shutter time
- * @param t_max Final shutter time
- * @param rec Hit record of the ray
- * @return true True if the rotated object is hit
- * @return false False if the rotated object is not hit
+ * @param r Ray to rotate
+ * @return ray<T> Rotated ray
  */
 template <typename T>
-bool x_rotation<T>::is_hit(const ray<T>& r,
-                           const T& t_min,
-                           const T& t_max,
-                           hit_rec<T>& rec) const {
+ray<T> x_rotation<T>::to_local(const ray<T>& r) const {
   point3<T> o = r.origin();
   vec3<T> d = r.direction();
 
@@ -152,11 +189,41 @@ bool x_rotation<T>::is_hit(const ray<T>& r,
   d[1] = cos_t * r.direction()[1] + sin_t * r.direction()[2];
   d[2] = -sin_t * r.direction()[1] + cos_t * r.direction()[2];
 
-  ray<T> rot_r(o, d, r.time());
+  return ray<T>(o, d, r.time());
+}
 
-  if (!p_->is_hit(rot_r, t_min, t_max, rec))
+/**
+ * @brief Returns whether a ray intersects the rotated object
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @param r Ray to compute
+ * @param t_min Initial shutter time
+ * @param t_max Final shutter time
+ * @param is Closest hit so far
+ * @return true True if the rotated object is hit
+ * @return false False if the rotated object is not hit
+ */
+template <typename T>
+bool x_rotation<T>::intersect(const ray<T>& r,
+                              const T& t_min,
+                              const T& t_max,
+                              isect<T>& is) const {
+  if (!p_->intersect(to_local(r), t_min, t_max, is))
     return false;
+  is.push(this);
+  return true;
+}
 
+/**
+ * @brief Rotate a hit back out of the object's frame
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @param rot_r Rotated ray the hit was found with
+ * @param rec Hit record to rotate
+ */
+template <typename T>
+void x_rotation<T>::to_world(const ray<T>& rot_r,
+                             hit_rec<T>& rec) const {
   point3<T> p = rec.p;
   vec3<T> n = rec.n;
 
@@ -168,6 +235,4 @@ bool x_rotation<T>::is_hit(const ray<T>& r,
 
   rec.p = p;
   rec.set_face(rot_r, n);
-
-  return true;
 }
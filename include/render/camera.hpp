@@ -15,6 +15,7 @@
 #pragma once
 
 #include "ray.hpp"
+#include "sampler.hpp"
 
 /**
  * @brief The camera class
@@ -70,17 +71,22 @@ class camera {
 
   /**
    * @brief Get the Ray object
+   * @details Takes two dimensions of the path for the point on the lens and
+   * one for the shutter time.
    *
    * @param s u value of pixel
    * @param t v value of pixel
+   * @param ss Numbers of the path
    * @return ray<T> Ray at (u,v)
    */
-  ray<T> getRay(const T& s, const T& t) const {
-    vec3<T> rd = r_ * random_disk_hat<T>();
+  ray<T> getRay(const T& s, const T& t, sample_stream& ss) const {
+    double a, b;
+    ss.get2d(a, b);
+    vec3<T> rd = r_ * disk_point(static_cast<T>(a), static_cast<T>(b));
     vec3<T> off = u * rd.getX() + v * rd.getY();
 
     return ray<T>(o_ + off, llc_ + s * hor_ + t * ver_ - o_ - off,
-                  random_double(t0_, t1_));
+                  static_cast<T>(t0_ + (t1_ - t0_) * ss.get1d()));
     // return ray<T>(o_, llc_ + s * hor_ + t * ver_ - o_);
   }
 
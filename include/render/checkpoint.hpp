@@ -0,0 +1,101 @@
+/**
+ * @file checkpoint.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Saving the state of a render to disk, and stopping it on a signal
+ * @details A checkpoint is the framebuffer state as written by
+ * framebuffer::save. It is written next to the old one and renamed over it,
+ * so a render killed while writing still leaves the last complete
+ * checkpoint behind. SIGINT and SIGTERM don't kill the render, they ask it
+ * to stop at the next pixel so it can be checkpointed first.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "render/framebuffer.hpp"
+
+/**
+ * @brief Whether the render has been asked to stop
+ *
+ * @return std::atomic<bool>& Flag, set by the signal handler
+ */
+inline std::atomic<bool>& stop_flag() {
+  static std::atomic<bool> flag{false};
+  return flag;
+}
+
+/**
+ * @brief Signal handler that asks the render to stop, a second signal kills
+ * it as usual
+ *
+ */
+inline void request_stop(int sig) {
+  stop_flag().store(true, std::memory_order_relaxed);
+  std::signal(sig, SIG_DFL);
+}
+
+/**
+ * @brief Stop the render on SIGINT and SIGTERM instead of being killed
+ *
+ */
+inline void catch_stop_signals() {
+  stop_flag();
+  std::signal(SIGINT, request_stop);
+  std::signal(SIGTERM, request_stop);
+}
+
+/**
+ * @brief Write a checkpoint of a framebuffer
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param path File to write
+ * @param fb Framebuffer to save
+ * @param config Fingerprint of the settings of the render
+ * @return true The checkpoint is in place
+ * @return false It couldn't be written, the old one is left alone
+ */
+template <typename T>
+bool save_checkpoint(const std::string& path,
+                     const framebuffer<T>& fb,
+                     const uint64_t& config) {
+  const std::string tmp = path + ".tmp";
+  std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+  if (!out || !fb.save(out, config))
+    return false;
+  // A cut short checkpoint would lose every pass behind the good one
+  out.close();
+  if (!out) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @brief Read a checkpoint into a framebuffer
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param path File to read
+ * @param fb Framebuffer of the size of the image
+ * @param config Fingerprint of the settings of the render
+ * @return true The framebuffer holds the checkpoint
+ * @return false No checkpoint of this image and settings, the framebuffer
+ * is unchanged
+ */
+template <typename T>
+bool load_checkpoint(const std::string& path,
+                     framebuffer<T>& fb,
+                     const uint64_t& config) {
+  std::ifstream in(path, std::ios::binary);
+  return in && fb.load(in, config);
+}
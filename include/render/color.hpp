@@ -1,9 +1,9 @@
 /**
  * @file color.hpp
  * @author Dylan Bassi (bassidj@mcmaster.ca)
- * @brief Wrapper file for color writing.
+ * @brief Wrapper file for color computation.
  * @details This file contains the function for calculating the pixel color for
- * a given ray, and the function to write it out.
+ * a given ray. Writing it out is left to render/image.hpp.
  * @version 0.1
  * @date 2020-12-04
  *
@@ -12,86 +12,206 @@
  */
 #pragma once
 
+#include <algorithm>
+
+#include "render/light_list.hpp"
 #include "vec3.hpp"
 
 /**
- * @brief Print r,g,b values of pixel_color to ostream out.
+ * @brief Russian roulette settings of a path
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct roulette {
+  /**
+   * @brief Bounces traced before a path may be cut, negative never cuts
+   *
+   */
+  int depth{-1};
+  /**
+   * @brief Largest chance of a path surviving a bounce
+   *
+   */
+  T max_prob{static_cast<T>(0.95)};
+};
+
+/**
+ * @brief How ray_color finds the light reaching a bounce
+ *
+ */
+enum class integrator {
+  // Only by scattering until a light is hit
+  path,
+  // Also by drawing points on the emitters (next event estimation)
+  nee,
+  // Both, weighed against each other with the power heuristic
+  mis,
+  // Ambient occlusion preview, white where a ray off the surface escapes
+  ao
+};
+
+/**
+ * @brief Power heuristic weight of a sample drawn with density a, when it
+ * could also have been drawn with density b
  *
  * @tparam T Datatype to be used (e.g float, double)
- * @param out Ostream to print out to
- * @param pixel_color Pixel color to print out
- * @param samples Number of rays per pixel
+ * @param a Density of the strategy that drew the sample
+ * @param b Density of the other strategy
+ * @return T Weight of the sample
  */
 template <typename T>
-void write_color(std::ostream& out,
-                 const color<T>& pixel_color,
-                 const int& samples) {
-  T r = pixel_color.getX();
-  T g = pixel_color.getY();
-  T b = pixel_color.getZ();
+T power_heuristic(const T& a, const T& b) {
+  const T a2 = a * a;
+  const T b2 = b * b;
+  return a2 > 0 ? a2 / (a2 + b2) : 0;
+}
 
-  // Remove possible NaN and replace with zero
-  if (r != r)
-    r = 0.0;
-  if (g != g)
-    g = 0.0;
-  if (b != b)
-    b = 0.0;
+/**
+ * @brief Ambient occlusion of the first surface a ray hits
+ * @details One cosine weighted ray is cast off the surface, and the surface
+ * is white if nothing blocks it within dist and black otherwise. Shading is
+ * never looked at, so this is a quick preview of the geometry.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param r Ray to compute
+ * @param bg Background color
+ * @param world Hit list constaining the scene
+ * @param dist Distance within which objects occlude
+ * @param ss Numbers of the path
+ * @return color<T> White, black or the background
+ */
+template <typename T>
+color<T> ao_color(const ray<T>& r,
+                  const color<T>& bg,
+                  const hit<T>& world,
+                  const T& dist,
+                  sample_stream& ss) {
+  hit_rec<T> rec;
+  if (!world.is_hit(r, 0.001, inf<T>, rec))
+    return bg;
 
-  T scale = static_cast<T>(1.0) / samples;
-  r = std::sqrt(scale * r);
-  g = std::sqrt(scale * g);
-  b = std::sqrt(scale * b);
-  // Write the translated [0,255] value of each color component.
-  // std::stringstream stream;
-  out << static_cast<int>(
-             static_cast<T>(256) *
-             my_clamp<T>(r, static_cast<T>(0.0), static_cast<T>(0.999)))
-      << ' '
-      << static_cast<int>(
-             static_cast<T>(256) *
-             my_clamp<T>(g, static_cast<T>(0.0), static_cast<T>(0.999)))
-      << ' '
-      << static_cast<int>(
-             static_cast<T>(256) *
-             my_clamp<T>(b, static_cast<T>(0.0), static_cast<T>(0.999)))
-      << '\n';
-  // out << stream.str();
+  double a, b;
+  ss.get2d(a, b);
+  vec3<T> dir = rec.n + sphere_point(static_cast<T>(a), static_cast<T>(b));
+  if (dir.near_null())
+    dir = rec.n;
+  if (world.occluded(ray<T>(rec.p, unit_v(dir), r.time()), 0.001, dist))
+    return color<T>(0, 0, 0);
+  return color<T>(1, 1, 1);
 }
 
 // Determine the color of our ray after interaction
 /**
  * @brief Calculate the color for a particular ray.
+ * @details The path is followed bounce by bounce, carrying the product of
+ * the attenuations seen so far. Past rr.depth bounces the path survives each
+ * bounce with a chance equal to its brightest channel (at most rr.max_prob)
+ * and the survivors are scaled up by that chance, so dim paths stop early
+ * without biasing the image.
+ *
+ * Unless mode is path, every bounce off a material that isn't a delta also
+ * draws a point on an emitter and adds its light if a shadow ray reaches
+ * it. With nee the emitter is then not counted when the scattered ray
+ * happens to hit it; with mis both are counted, each weighed by the power
+ * heuristic of the densities of the two ways of finding it. The scattered
+ * directions of diffuse and isotropic materials and the points on the
+ * emitters are drawn from the sampler of the path, everything else from its
+ * engine.
  *
  * @tparam T Datatype to be used (e.g float, double)
  * @param r Ray to compute
  * @param bg Background color
  * @param world Hit list constaining the scene
- * @param depth Maximum recursion depth
+ * @param depth Maximum number of bounces
+ * @param g Engine of the path
+ * @param ss Numbers of the path, past the camera's
+ * @param rr Russian roulette settings
+ * @param lights Emitters to sample, null for none
+ * @param mode Integrator to use
  * @return color<T> Color of the ray
  */
 template <typename T>
 color<T> ray_color(const ray<T>& r,
                    const color<T>& bg,
                    const hit<T>& world,
-                   int depth) {
+                   int depth,
+                   rng& g,
+                   sample_stream& ss,
+                   const roulette<T>& rr = roulette<T>(),
+                   const light_list<T>* lights = nullptr,
+                   integrator mode = integrator::path) {
   hit_rec<T> rec;
+  color<T> sum(0, 0, 0);
+  color<T> through(1, 1, 1);
+  ray<T> cur = r;
+  const bool use_lights =
+      mode != integrator::path && lights && !lights->empty();
+  // Whether the last bounce sampled the lights, from where and with what
+  // density it scattered
+  bool sampled = false;
+  point3<T> from;
+  T scat_pdf = 0;
 
   // Limit of bouncing; stop gathering light
-  if (depth <= 0)
-    return color<T>(0, 0, 0);
+  for (int bounce = 0; bounce < depth; bounce++) {
+    // Add the bg when we dont hit
+    if (!world.is_hit(cur, 0.001, inf<T>, rec)) {
+      sum += through * bg;
+      break;
+    }
 
-  // Return the bg when we dont hit
-  if (!world.is_hit(r, 0.001, inf<T>, rec))
-    return bg;
+    if (sampled && rec.mat->emits() && lights->contains(rec.obj)) {
+      if (mode == integrator::mis) {
+        const T lp = lights->pdf(rec.obj, from, rec.p);
+        sum += through * rec.mat->emit(rec.u, rec.v, rec.p) *
+               power_heuristic(scat_pdf, lp);
+      }
+    } else {
+      sum += through * rec.mat->emit(rec.u, rec.v, rec.p);
+    }
 
-  color<T> c;
-  ray<T> scat;
-  color<T> light = rec.mat->emit(rec.u, rec.v, rec.p);
+    color<T> c;
+    ray<T> scat;
+    // If we hit a light source
+    double a, b;
+    ss.get2d(a, b);
+    if (!rec.mat->sample(cur, rec, c, scat, scat_pdf, static_cast<T>(a),
+                         static_cast<T>(b), g))
+      break;
 
-  // If we hit a light source
-  if (!rec.mat->scatter(r, rec, c, scat))
-    return light;
+    sampled = use_lights && !rec.mat->is_delta();
+    if (sampled) {
+      light_sample<T> ls;
+      color<T> le;
+      if (lights->sample(rec.p, ss, ls, le)) {
+        const vec3<T> to = ls.p - rec.p;
+        const T dist = to.norm();
+        const vec3<T> dir = to / dist;
+        const color<T> f = rec.mat->eval(cur, rec, dir);
+        if (f[0] + f[1] + f[2] > 0 &&
+            !world.occluded(ray<T>(rec.p, dir, cur.time()), 0.001,
+                            dist - static_cast<T>(0.001))) {
+          const T w = mode == integrator::mis
+                          ? power_heuristic(ls.pdf, rec.mat->pdf(cur, rec, dir))
+                          : 1;
+          sum += through * f * le * (w / ls.pdf);
+        }
+      }
+    } else if (use_lights) {
+      ss.skip(light_list<T>::dims);
+    }
+    through = through * c;
+    from = rec.p;
 
-  return light + c * ray_color<T>(scat, bg, world, depth - 1);
+    if (rr.depth >= 0 && bounce + 1 >= rr.depth) {
+      T p = std::max(through[0], std::max(through[1], through[2]));
+      p = std::min(p, rr.max_prob);
+      if (random_double(g) >= p)
+        break;
+      through /= p;
+    }
+    cur = scat;
+  }
+  return sum;
 }
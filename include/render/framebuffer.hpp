@@ -0,0 +1,377 @@
+/**
+ * @file framebuffer.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Shared image buffer that render workers write finished pixels into
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "color.hpp"
+#include "image.hpp"
+
+/**
+ * @brief Running mean and variance of a stream of values (Welford)
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct welford {
+  int n{0};
+  T mean{0};
+  T m2{0};
+
+  /**
+   * @brief Add a value
+   *
+   * @param x Value
+   */
+  void add(const T& x) {
+    n++;
+    const T d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+  }
+
+  /**
+   * @brief Standard error of the mean over the mean
+   * @details Means below floor are taken as floor, so a pixel that is black
+   * and stays black converges instead of dividing by zero.
+   *
+   * @param floor Smallest mean to divide by
+   * @return T Relative error, infinite before two values
+   */
+  T rel_err(const T& floor) const {
+    if (n < 2)
+      return inf<T>;
+    const T var = m2 / (n - 1);
+    return std::sqrt(var / n) / std::max(mean, floor);
+  }
+};
+
+/**
+ * @brief Image buffer holding the summed samples of every pixel, how many
+ * samples were taken and their running statistics
+ * @details Pixels are indexed like the render loop: i runs left to right and
+ * j runs bottom to top. Colors are summed in float whatever T is, each pass
+ * over a pixel is summed in T first and added in one go. Each pixel is only
+ * ever written by the worker that owns its tile, so no locking is needed.
+ * The whole state can be saved and loaded back, so a render can go on from
+ * where it stopped.
+ *
+ * A framebuffer may hold only a window of a larger image, for renders split
+ * over several processes. Pixels keep the indices of the whole image.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+class framebuffer {
+ public:
+  /**
+   * @brief Construct a new framebuffer object, cleared to black
+   *
+   * @param width Width of the window in pixels
+   * @param height Height of the window in pixels
+   * @param x0 Column of the left edge of the window in the image
+   * @param y0 Row of the bottom edge of the window in the image
+   */
+  framebuffer(const int& width,
+              const int& height,
+              const int& x0 = 0,
+              const int& y0 = 0)
+      : w_(width),
+        h_(height),
+        x0_(x0),
+        y0_(y0),
+        px_(static_cast<size_t>(width) * height),
+        n_(px_.size(), 0),
+        st_(px_.size()) {}
+
+  /**
+   * @brief Return the width of the window
+   *
+   * @return int Width in pixels
+   */
+  int width() const { return w_; }
+  /**
+   * @brief Return the height of the window
+   *
+   * @return int Height in pixels
+   */
+  int height() const { return h_; }
+  /**
+   * @brief Return the column of the left edge of the window
+   *
+   * @return int Column in the image
+   */
+  int x0() const { return x0_; }
+  /**
+   * @brief Return the row of the bottom edge of the window
+   *
+   * @return int Row in the image, from the bottom
+   */
+  int y0() const { return y0_; }
+
+  /**
+   * @brief Return the summed color of a pixel
+   *
+   * @param i Column, from the left
+   * @param j Row, from the bottom
+   * @return const color<float>& Summed color of the pixel
+   */
+  const color<float>& at(const int& i, const int& j) const {
+    return px_[index(i, j)];
+  }
+
+  /**
+   * @brief Add samples to the summed color of a pixel
+   *
+   * @param i Column, from the left
+   * @param j Row, from the bottom
+   * @param c Sum of the new samples
+   */
+  void add(const int& i, const int& j, const color<T>& c) {
+    color<float>& p = px_[index(i, j)];
+    for (int k = 0; k < 3; k++)
+      p[k] += static_cast<float>(c[k]);
+  }
+
+  /**
+   * @brief Return the number of samples summed into a pixel
+   *
+   * @param i Column, from the left
+   * @param j Row, from the bottom
+   * @return int& Samples of the pixel
+   */
+  int& samples(const int& i, const int& j) {
+    return n_[index(i, j)];
+  }
+  /**
+   * @brief Return the number of samples summed into a pixel
+   *
+   * @param i Column, from the left
+   * @param j Row, from the bottom
+   * @return int Samples of the pixel
+   */
+  int samples(const int& i, const int& j) const {
+    return n_[index(i, j)];
+  }
+
+  /**
+   * @brief Return the running statistics of the samples of a pixel, kept
+   * by adaptive sampling
+   *
+   * @param i Column, from the left
+   * @param j Row, from the bottom
+   * @return welford<T>& Statistics of the pixel
+   */
+  welford<T>& stats(const int& i, const int& j) {
+    return st_[index(i, j)];
+  }
+
+  /**
+   * @brief Return the total number of samples taken
+   *
+   * @return long long Samples of every pixel
+   */
+  long long total_samples() const {
+    long long n = 0;
+    for (int c : n_)
+      n += c;
+    return n;
+  }
+
+  /**
+   * @brief Estimate of the noise left in the image
+   * @details Root mean square over the pixels of the standard error of
+   * their brightness, gamma 2 and clipped at white as it is written out.
+   * Pixels with fewer than two samples are left out.
+   *
+   * @return T Noise, as a fraction of white
+   */
+  T noise() const {
+    T sum = 0;
+    size_t k = 0;
+    for (const welford<T>& w : st_) {
+      if (w.n < 2)
+        continue;
+      sum += w.m2 / (w.n - 1) / w.n;
+      k++;
+    }
+    return k ? std::sqrt(sum / k) : 0;
+  }
+
+  /**
+   * @brief Return the fewest samples taken by any pixel
+   *
+   * @return int Samples of the least sampled pixel
+   */
+  int min_samples() const {
+    return n_.empty() ? 0 : *std::min_element(n_.begin(), n_.end());
+  }
+
+  /**
+   * @brief Write the whole state in binary, for load
+   *
+   * @param out Binary ostream to write to
+   * @param config Fingerprint of the settings the state was rendered with
+   * @return true The state was written
+   * @return false The stream failed
+   */
+  bool save(std::ostream& out, const uint64_t& config) const {
+    const uint32_t head[8] = {magic,
+                              static_cast<uint32_t>(sizeof(T)),
+                              static_cast<uint32_t>(w_),
+                              static_cast<uint32_t>(h_),
+                              static_cast<uint32_t>(x0_),
+                              static_cast<uint32_t>(y0_),
+                              static_cast<uint32_t>(config),
+                              static_cast<uint32_t>(config >> 32)};
+    out.write(reinterpret_cast<const char*>(head), sizeof(head));
+    write_all(out, px_);
+    write_all(out, n_);
+    write_all(out, st_);
+    return static_cast<bool>(out);
+  }
+
+  /**
+   * @brief Read back a state written by save
+   *
+   * @param in Binary istream to read from
+   * @param config Fingerprint of the settings to render with
+   * @return true The state was read, for a window of the same place, size
+   * and type rendered with the same settings
+   * @return false The stream failed or holds another image, the framebuffer
+   * is unchanged
+   */
+  bool load(std::istream& in, const uint64_t& config) {
+    uint32_t head[8];
+    if (!in.read(reinterpret_cast<char*>(head), sizeof(head)) ||
+        head[0] != magic || head[1] != sizeof(T) ||
+        head[2] != static_cast<uint32_t>(w_) ||
+        head[3] != static_cast<uint32_t>(h_) ||
+        head[4] != static_cast<uint32_t>(x0_) ||
+        head[5] != static_cast<uint32_t>(y0_) ||
+        head[6] != static_cast<uint32_t>(config) ||
+        head[7] != static_cast<uint32_t>(config >> 32))
+      return false;
+    std::vector<color<float>> px(px_.size());
+    std::vector<int> n(n_.size());
+    std::vector<welford<T>> st(st_.size());
+    if (!read_all(in, px) || !read_all(in, n) || !read_all(in, st))
+      return false;
+    px_.swap(px);
+    n_.swap(n);
+    st_.swap(st);
+    return true;
+  }
+
+  /**
+   * @brief Average every pixel over its own samples, for tonemapping or
+   * writing out
+   *
+   * @return hdr_image Linear image of the window, top row first
+   */
+  hdr_image resolve() const {
+    hdr_image img;
+    img.width = w_;
+    img.height = h_;
+    img.rgb.resize(px_.size() * 3);
+    float* o = img.rgb.data();
+    for (int j = y0_ + h_ - 1; j >= y0_; --j)
+      for (int i = x0_; i < x0_ + w_; ++i) {
+        const float n = static_cast<float>(std::max(1, samples(i, j)));
+        const color<float>& p = at(i, j);
+        for (int k = 0; k < 3; k++)
+          *o++ = p[k] / n;
+      }
+    return img;
+  }
+
+  /**
+   * @brief Write the samples taken per pixel as a text .pgm, top row first,
+   * scaled so that max samples is white
+   *
+   * @param out Ostream to print out to
+   * @param max Number of samples drawn as white
+   */
+  void write_samples(std::ostream& out, const int& max) const {
+    out << "P2\n" << w_ << " " << h_ << "\n255\n";
+    for (int j = y0_ + h_ - 1; j >= y0_; --j)
+      for (int i = x0_; i < x0_ + w_; ++i)
+        out << std::min(255, 255 * samples(i, j) / std::max(1, max)) << '\n';
+  }
+
+ private:
+  /**
+   * @brief Offset of a pixel in the vectors
+   *
+   */
+  size_t index(const int& i, const int& j) const {
+    return static_cast<size_t>(j - y0_) * w_ + (i - x0_);
+  }
+
+  /**
+   * @brief First word of a saved state
+   *
+   */
+  static constexpr uint32_t magic = 0x34434652;  // "RFC4"
+
+  /**
+   * @brief Write the bytes of a vector
+   *
+   */
+  template <typename X>
+  static void write_all(std::ostream& out, const std::vector<X>& v) {
+    out.write(reinterpret_cast<const char*>(v.data()),
+              static_cast<std::streamsize>(v.size() * sizeof(X)));
+  }
+
+  /**
+   * @brief Read the bytes of a vector of known size
+   *
+   */
+  template <typename X>
+  static bool read_all(std::istream& in, std::vector<X>& v) {
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char*>(v.data()),
+                static_cast<std::streamsize>(v.size() * sizeof(X))));
+  }
+
+  /**
+   * @brief Width and height of the window
+   *
+   */
+  int w_, h_;
+  /**
+   * @brief Place of the bottom left pixel of the window in the image
+   *
+   */
+  int x0_, y0_;
+  /**
+   * @brief Summed color of each pixel, row major from the bottom row of
+   * the window
+   *
+   */
+  std::vector<color<float>> px_;
+  /**
+   * @brief Samples summed into each pixel, in the order of px_
+   *
+   */
+  std::vector<int> n_;
+  /**
+   * @brief Running statistics of each pixel, in the order of px_
+   *
+   */
+  std::vector<welford<T>> st_;
+};
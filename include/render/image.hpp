@@ -0,0 +1,62 @@
+/**
+ * @file image.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Finished images, in linear light and tonemapped for display
+ * @details The framebuffer resolves into an hdr_image of linear, unclamped
+ * radiance, which HDR formats store as is. Tonemapping into an 8 bit
+ * ldr_image for PPM or PNG is a separate step done on the whole image.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Image of linear radiance, three floats per pixel, top row first
+ *
+ */
+struct hdr_image {
+  int width{0}, height{0};
+  std::vector<float> rgb;
+};
+
+/**
+ * @brief Image of 8 bit display values, three bytes per pixel, top row
+ * first
+ *
+ */
+struct ldr_image {
+  int width{0}, height{0};
+  std::vector<uint8_t> rgb;
+};
+
+/**
+ * @brief Tonemap a linear image for display
+ * @details Each channel is gamma corrected with a gamma of 2 and clipped at
+ * white, as the text output always did. NaNs turn black.
+ *
+ * @param img Linear image
+ * @return ldr_image Display image
+ */
+inline ldr_image tonemap(const hdr_image& img) {
+  ldr_image out;
+  out.width = img.width;
+  out.height = img.height;
+  out.rgb.resize(img.rgb.size());
+  for (size_t k = 0; k < img.rgb.size(); k++) {
+    float x = img.rgb[k];
+    if (x != x)
+      x = 0;
+    x = std::sqrt(x);
+    x = x < 0 ? 0 : (x > 0.999f ? 0.999f : x);
+    out.rgb[k] = static_cast<uint8_t>(256 * x);
+  }
+  return out;
+}
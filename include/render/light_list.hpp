@@ -0,0 +1,156 @@
+/**
+ * @file light_list.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Registry of the emitters of a scene, for light sampling
+ * @details Every object of the world whose emitter() is set (rectangles and
+ * spheres with an emissive material) is collected when the list is made.
+ * The integrator then draws points on them directly instead of waiting for
+ * a bounced ray to find them. Emitters inside wrappers or cubes are not
+ * collected and are still only found by scattering.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "materials/material.hpp"
+#include "objects/bvh.hpp"
+#include "objects/hit_list.hpp"
+#include "render/sampler.hpp"
+
+/**
+ * @brief Emitters of a scene that can be sampled
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+class light_list {
+ public:
+  /**
+   * @brief Construct an empty light list
+   *
+   */
+  light_list() {}
+  /**
+   * @brief Collect the emitters of a world
+   * @details bvh_node and hit_list objects are opened up. Must be made from
+   * the world before it is flattened, as flat trees don't keep the objects'
+   * lists.
+   *
+   * @param world Objects of the scene
+   */
+  explicit light_list(const hit_list<T>& world) {
+    for (const hit<T>* o : world.objects())
+      gather(o);
+    sorted_ = lights_;
+    std::sort(sorted_.begin(), sorted_.end());
+  }
+
+  /**
+   * @brief Whether the scene has no emitters to sample
+   *
+   * @return true No emitters
+   * @return false At least one emitter
+   */
+  bool empty() const { return lights_.empty(); }
+
+  /**
+   * @brief Return the number of emitters
+   *
+   * @return size_t Number of emitters
+   */
+  size_t size() const { return lights_.size(); }
+
+  /**
+   * @brief Whether an object is one of the sampled emitters
+   *
+   * @param o Object, as recorded in a hit record
+   * @return true Light sampling already accounts for the object
+   * @return false The object is not in the list
+   */
+  bool contains(const hit<T>* o) const {
+    return std::binary_search(sorted_.begin(), sorted_.end(), o);
+  }
+
+  /**
+   * @brief Draw a point on one of the emitters, picked uniformly
+   * @details Takes one dimension of the path for the pick and two for the
+   * point on the emitter, dims in all.
+   *
+   * @param o Point the emitters are seen from
+   * @param ss Numbers of the path
+   * @param s Drawn point, its density includes the pick of the emitter
+   * @param le Light emitted at the drawn point
+   * @return true A point was drawn
+   * @return false The picked emitter can't be seen from o
+   */
+  bool sample(const point3<T>& o,
+              sample_stream& ss,
+              light_sample<T>& s,
+              color<T>& le) const {
+    const size_t n = lights_.size();
+    const size_t k = std::min(
+        n - 1, static_cast<size_t>(ss.get1d() * static_cast<double>(n)));
+    double a, b;
+    ss.get2d(a, b);
+    const hit<T>* l = lights_[k];
+    if (!l->sample(o, static_cast<T>(a), static_cast<T>(b), s))
+      return false;
+    s.pdf /= static_cast<T>(n);
+    le = l->emitter()->emit(s.u, s.v, s.p);
+    return true;
+  }
+
+  /**
+   * @brief Number of dimensions of the path sample takes
+   *
+   */
+  static constexpr uint32_t dims = 3;
+
+  /**
+   * @brief Density with which sample draws a point of one of the emitters
+   *
+   * @param l Emitter, one the list contains
+   * @param o Point the emitters are seen from
+   * @param p Point on the emitter
+   * @return T Density per unit solid angle, including the pick of l
+   */
+  T pdf(const hit<T>* l, const point3<T>& o, const point3<T>& p) const {
+    return l->pdf(o, p) / static_cast<T>(lights_.size());
+  }
+
+ private:
+  /**
+   * @brief Collect the emitters of an object, opening up trees and lists
+   *
+   */
+  void gather(const hit<T>* o) {
+    if (auto node = dynamic_cast<const bvh_node<T>*>(o)) {
+      gather(node->left());
+      if (node->right() && node->right() != node->left())
+        gather(node->right());
+    } else if (auto list = dynamic_cast<const hit_list<T>*>(o)) {
+      for (const hit<T>* c : list->objects())
+        gather(c);
+    } else if (o->emitter()) {
+      lights_.push_back(o);
+    }
+  }
+
+  /**
+   * @brief Emitters in scene order, owned by the scene
+   *
+   */
+  std::vector<const hit<T>*> lights_;
+  /**
+   * @brief Emitters sorted by address, for contains
+   *
+   */
+  std::vector<const hit<T>*> sorted_;
+};
@@ -0,0 +1,297 @@
+/**
+ * @file renderer.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Tile based parallel renderer
+ * @details The image is cut into square tiles which are handed to the workers
+ * of a thread_pool. Each tile is traced exactly like the old scanline loop and
+ * its pixels are written straight into a shared framebuffer. The position in
+ * the pixel, the lens, the shutter and the light samples of a path come from
+ * the sampler; the engines of a path are seeded from a hash of its pixel and
+ * sample, with one stream for the bounces and one for anything drawing from
+ * thread_rng, so the image is the same at any thread count.
+ *
+ * With adaptive sampling each pixel keeps a running mean and variance of its
+ * samples and stops once its relative error is small enough, so flat or
+ * black parts of the image don't take the samples the noisy parts need.
+ * Pixels that stay noisy go on up to ns samples.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "objects/hit.hpp"
+#include "render/camera.hpp"
+#include "render/color.hpp"
+#include "render/framebuffer.hpp"
+#include "render/sampler.hpp"
+#include "render/thread_pool.hpp"
+
+/**
+ * @brief Rectangle of pixels rendered as one job, [x0,x1) x [y0,y1)
+ *
+ */
+struct tile {
+  int x0, y0, x1, y1;
+};
+
+/**
+ * @brief Cut a window of an image into tiles, top rows first
+ *
+ * @param area Window to cover
+ * @param size Edge length of a tile in pixels
+ * @return std::vector<tile> Tiles covering the window
+ */
+inline std::vector<tile> make_tiles(const tile& area, const int& size) {
+  std::vector<tile> tiles;
+  for (int y1 = area.y1; y1 > area.y0; y1 -= size)
+    for (int x0 = area.x0; x0 < area.x1; x0 += size)
+      tiles.push_back(tile{x0, std::max(area.y0, y1 - size),
+                           std::min(area.x1, x0 + size), y1});
+  return tiles;
+}
+
+/**
+ * @brief Cut an image into tiles, top rows first
+ *
+ * @param width Width of the image in pixels
+ * @param height Height of the image in pixels
+ * @param size Edge length of a tile in pixels
+ * @return std::vector<tile> Tiles covering the image
+ */
+inline std::vector<tile> make_tiles(const int& width,
+                                    const int& height,
+                                    const int& size) {
+  return make_tiles(tile{0, 0, width, height}, size);
+}
+
+/**
+ * @brief Settings shared by every tile of a render
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+struct render_settings {
+  int width, height;
+  // Samples per pixel, the most any pixel takes when adaptive
+  int ns;
+  // Adaptive sampling: every pixel takes min_spp samples, then more until
+  // the relative error of its brightness is below adapt_err (0: off, always
+  // ns)
+  int min_spp{0};
+  T adapt_err{0};
+  int max_depth;
+  roulette<T> rr;
+  // Emitters sampled at every bounce by the nee and mis integrators
+  const light_list<T>* lights{nullptr};
+  integrator mode{integrator::path};
+  // Reach of the occlusion rays of the ao integrator
+  T ao_dist{inf<T>};
+  // Numbers of the camera, scatter and light samples, independent when null
+  const sampler* smp{nullptr};
+  color<T> bg;
+  int tile_size;
+  // Samples added to every pixel per pass (0: all ns in one pass)
+  int pass_spp{0};
+  // Once set, the render stops at the next pixel
+  const std::atomic<bool>* stop{nullptr};
+  // Seconds the render may take, ns is then the most it goes to (0: no
+  // limit)
+  double time_budget{0};
+};
+
+/**
+ * @brief Trace the samples of every pixel in a tile up to a number of
+ * samples
+ * @details Pixels go on from the samples already in the framebuffer. A pixel
+ * is only written once all its samples of this call are in, so a tile cut
+ * short by a stop holds whole pixels.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param tl Tile to render
+ * @param cam Camera to trace from
+ * @param world Scene to trace against
+ * @param set Render settings
+ * @param fb Framebuffer to add the samples, their count and statistics to
+ * @param target Number of samples each pixel should have afterwards
+ * @param deadline Time at which to stop, pixels begun before it are
+ * finished
+ */
+template <typename T>
+void render_tile(const tile& tl,
+                 const camera<T>& cam,
+                 const hit<T>& world,
+                 const render_settings<T>& set,
+                 framebuffer<T>& fb,
+                 const int& target,
+                 const std::chrono::steady_clock::time_point& deadline =
+                     std::chrono::steady_clock::time_point::max()) {
+  const bool timed = deadline != std::chrono::steady_clock::time_point::max();
+  const independent_sampler fallback{};
+  const sampler& smp = set.smp ? *set.smp : fallback;
+  const bool adapt = set.adapt_err > 0;
+  const int n_min = adapt ? std::max(2, std::min(set.min_spp, set.ns)) : set.ns;
+  for (int j = tl.y1 - 1; j >= tl.y0; --j) {
+    for (int i = tl.x0; i < tl.x1; ++i) {
+      if ((set.stop && set.stop->load(std::memory_order_relaxed)) ||
+          (timed && std::chrono::steady_clock::now() >= deadline))
+        return;
+      const uint64_t pixel = static_cast<uint64_t>(j) * set.width + i;
+      color<T> px(0, 0, 0);
+      welford<T> stat = fb.stats(i, j);
+      int s = fb.samples(i, j);
+      for (; s < target; ++s) {
+        // Checked once per batch of n_min samples, a check after every
+        // sample stops too often on a lucky run of low variance. Pixels
+        // darker than one step of an 8 bit output are judged by their
+        // absolute error instead.
+        if (adapt && s >= n_min && s % n_min == 0 &&
+            stat.rel_err(static_cast<T>(1.0 / 256)) < set.adapt_err)
+          break;
+        // Every path is seeded from its pixel and sample alone, so the image
+        // does not depend on which thread traced it
+        const uint64_t key = hash_seed(pixel, s);
+        sample_stream ss(smp, pixel, static_cast<uint32_t>(s));
+        rng path_g(key, 1);
+        thread_rng().seed(key, 2);
+
+        double du, dv;
+        ss.get2d(du, dv);
+        T u = static_cast<T>(i + du) / (set.width - 1);
+        T v = static_cast<T>(j + dv) / (set.height - 1);
+        ray<T> r = cam.getRay(u, v, ss);
+        const color<T> c =
+            set.mode == integrator::ao
+                ? ao_color(r, set.bg, world, set.ao_dist, ss)
+                : ray_color(r, set.bg, world, set.max_depth, path_g, ss,
+                            set.rr, set.lights, set.mode);
+        px += c;
+        // Errors are measured on the brightness as written out: gamma 2 and
+        // clipped at white. Kept for every pixel, for the noise estimate.
+        stat.add(std::sqrt(my_clamp<T>(static_cast<T>(0.2126) * c[0] +
+                                           static_cast<T>(0.7152) * c[1] +
+                                           static_cast<T>(0.0722) * c[2],
+                                       0, 1)));
+      }
+      fb.add(i, j, px);
+      fb.samples(i, j) = s;
+      fb.stats(i, j) = stat;
+    }
+  }
+}
+
+/**
+ * @brief How a render ended
+ *
+ */
+enum class render_end { done, stopped, out_of_time };
+
+/**
+ * @brief Render the window of the framebuffer over the workers of a thread
+ * pool, in passes
+ * @details Each pass takes every pixel up to pass_spp more samples, until
+ * they all have ns. Pixels go on from the samples already in the
+ * framebuffer, so a render loaded from a checkpoint picks up where it left
+ * off, and the image comes out the same as if it had never stopped. A pixel
+ * also comes out the same whatever window it is rendered in, so windows
+ * rendered apart can be put back together.
+ *
+ * With a time budget a first pass of one sample per pixel is always run to
+ * the end, however long it takes, so every pixel has a sample. From then
+ * on the slowest pass so far gives the time a sample per pixel takes, and
+ * the next pass is cut down to what fits in the time left. Once not even
+ * one sample per pixel fits the render ends. Should a pass run late anyway,
+ * it stops at the deadline with whole pixels.
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param cam Camera to trace from
+ * @param world Scene to trace against
+ * @param set Render settings
+ * @param fb Framebuffer to add the samples to
+ * @param pool Thread pool to spread the tiles over
+ * @param on_pass Called after every complete pass with the samples per pixel
+ * reached, e.g to write a checkpoint
+ * @return render_end Whether every pixel has all its samples, the render
+ * was stopped or it ran out of time
+ */
+template <typename T>
+render_end render(const camera<T>& cam,
+                  const hit<T>& world,
+                  const render_settings<T>& set,
+                  framebuffer<T>& fb,
+                  thread_pool& pool,
+                  const std::function<void(int)>& on_pass = nullptr) {
+  using clock = std::chrono::steady_clock;
+  const std::vector<tile> tiles =
+      make_tiles(tile{fb.x0(), fb.y0(), fb.x0() + fb.width(),
+                      fb.y0() + fb.height()},
+                 std::max(1, set.tile_size));
+  const int step = set.pass_spp > 0 ? std::min(set.pass_spp, set.ns) : set.ns;
+  const bool timed = set.time_budget > 0;
+  const clock::time_point deadline =
+      timed ? clock::now() + std::chrono::duration_cast<clock::duration>(
+                                 std::chrono::duration<double>(set.time_budget))
+            : clock::time_point::max();
+  // Seconds per sample per pixel of the slowest pass
+  double rate = 0;
+  std::mutex log;
+
+  for (int done = fb.min_samples(); done < set.ns;) {
+    int target = std::min(set.ns, (done / step + 1) * step);
+    // The first timed pass takes one sample per pixel and always finishes,
+    // so no pixel is left black and the rate is measured before anything
+    // is sized from it
+    const bool calibrate = timed && rate == 0;
+    if (calibrate) {
+      target = done + 1;
+    } else if (timed) {
+      const double left =
+          std::chrono::duration<double>(deadline - clock::now()).count();
+      const double fit = left / rate;
+      if (fit < 1)
+        return render_end::out_of_time;
+      target = std::min(target, done + static_cast<int>(std::min(
+                                           fit, static_cast<double>(step))));
+    }
+
+    const clock::time_point t0 = clock::now();
+    std::atomic<size_t> left{tiles.size()};
+    pool.run(tiles.size(), [&](size_t k, size_t) {
+      render_tile(tiles[k], cam, world, set, fb, target,
+                  calibrate ? clock::time_point::max() : deadline);
+
+      //   Use std::cerr to print to terminal while writing file
+      size_t n = --left;
+      std::lock_guard<std::mutex> lock(log);
+      std::cerr << "\rSamples " << target << "/" << set.ns
+                << ", tiles remaining: " << n << " " << std::flush;
+    });
+    if (set.stop && set.stop->load())
+      return render_end::stopped;
+    const clock::time_point t1 = clock::now();
+    rate = std::max(rate, std::chrono::duration<double>(t1 - t0).count() /
+                              (target - done));
+    done = target;
+    if (calibrate && t1 >= deadline) {
+      std::lock_guard<std::mutex> lock(log);
+      std::cerr << "\nThe time budget does not fit one sample per pixel, "
+                << "which took " << rate << " seconds.";
+    }
+    if (on_pass)
+      on_pass(done);
+    if (t1 >= deadline)
+      return done >= set.ns ? render_end::done : render_end::out_of_time;
+  }
+  return render_end::done;
+}
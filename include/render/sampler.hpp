@@ -0,0 +1,445 @@
+/**
+ * @file sampler.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Samplers that hand out the random numbers of a path dimension by
+ * dimension
+ * @details A path asks for its numbers in a fixed order: the position in the
+ * pixel, the point on the lens, the shutter time, and then at every bounce
+ * the scattered direction, the pick of an emitter and the point drawn on
+ * it. Each of these is a dimension, and each sampler is a function of
+ * (pixel, sample, dimension) alone, so every dimension is its own stream and
+ * the image does not depend on the thread that traced it.
+ *
+ * The independent sampler draws every number on its own, like the engines
+ * did. The others spread the samples of a pixel evenly over each dimension:
+ * stratified jitters them in a grid, sobol and halton take successive points
+ * of a low discrepancy sequence. Each pixel and dimension gets its own
+ * scrambling, so pixels and dimensions aren't correlated with each other.
+ * Numbers drawn by materials that need more than a point of the unit square
+ * (metal, glass, fog distances) and by Russian roulette still come from the
+ * engine of the path.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "rng.hpp"
+
+/**
+ * @brief Kind of sampler, in the order of the sampler config key
+ *
+ */
+enum class sampler_kind { independent, stratified, sobol, halton };
+
+/**
+ * @brief Turn 32 random bits into a number in [0,1)
+ *
+ */
+inline double unit_32(uint32_t x) {
+  return static_cast<double>(x) * (1.0 / 4294967296.0);
+}
+
+/**
+ * @brief Turn the top 53 of 64 random bits into a number in [0,1)
+ *
+ */
+inline double unit_64(uint64_t x) {
+  return static_cast<double>(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Random permutation of [0,l), picked by p (Kensler, "Correlated
+ * Multi-Jittered Sampling")
+ *
+ * @param i Value to permute, in [0,l)
+ * @param l Length of the permutation
+ * @param p Pattern, each value gives a different permutation
+ * @return uint32_t Where the permutation sends i
+ */
+inline uint32_t permute(uint32_t i, uint32_t l, uint32_t p) {
+  uint32_t w = l - 1;
+  w |= w >> 1;
+  w |= w >> 2;
+  w |= w >> 4;
+  w |= w >> 8;
+  w |= w >> 16;
+  // Permute within the next power of two and walk out of [l,w]
+  do {
+    i ^= p;
+    i *= 0xe170893d;
+    i ^= p >> 16;
+    i ^= (i & w) >> 4;
+    i ^= p >> 8;
+    i *= 0x0929eb3f;
+    i ^= p >> 23;
+    i ^= (i & w) >> 1;
+    i *= 1 | p >> 27;
+    i *= 0x6935fa69;
+    i ^= (i & w) >> 11;
+    i *= 0x74dcb303;
+    i ^= (i & w) >> 2;
+    i *= 0x9e501cc3;
+    i ^= (i & w) >> 2;
+    i *= 0xc860a3df;
+    i &= w;
+    i ^= i >> 5;
+  } while (i >= l);
+  return (i + p) % l;
+}
+
+/**
+ * @brief Reverse the bits of a 32 bit word
+ *
+ */
+inline uint32_t reverse_bits(uint32_t x) {
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+/**
+ * @brief Owen scrambling of the binary digits of a number in [0,1) held as
+ * 32 bits of fraction (Burley, "Practical Hash-based Owen Scrambling")
+ * @details Each bit is flipped by a hash of the bits above it, which is the
+ * nested uniform scrambling of Owen. Points of a (0,m,2) net stay a net.
+ *
+ * @param x Fraction bits, most significant first
+ * @param seed Scrambling to apply
+ * @return uint32_t Scrambled fraction bits
+ */
+inline uint32_t owen_scramble(uint32_t x, uint32_t seed) {
+  x = reverse_bits(x);
+  // Multiplication only carries low bits up, so every bit depends on the
+  // ones below it, which are the more significant ones before reversal
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return reverse_bits(x);
+}
+
+/**
+ * @brief Source of the numbers of every path of a render
+ * @details Samplers hold no state of a path, so one sampler serves every
+ * thread. A path reads its numbers through a sample_stream.
+ *
+ */
+class sampler {
+ public:
+  virtual ~sampler() {}
+
+  /**
+   * @brief Number in [0,1) of one dimension of a sample
+   *
+   * @param pixel Index of the pixel
+   * @param index Index of the sample within the pixel
+   * @param dim Dimension
+   * @return double Sample value
+   */
+  virtual double get1d(uint64_t pixel, uint32_t index, uint32_t dim) const = 0;
+
+  /**
+   * @brief Point in [0,1)^2 of two dimensions of a sample, drawn together so
+   * they are spread evenly over the square and not only along each axis
+   *
+   * @param pixel Index of the pixel
+   * @param index Index of the sample within the pixel
+   * @param dim First of the two dimensions
+   * @param x First coordinate
+   * @param y Second coordinate
+   */
+  virtual void get2d(uint64_t pixel,
+                     uint32_t index,
+                     uint32_t dim,
+                     double& x,
+                     double& y) const = 0;
+};
+
+/**
+ * @brief Every dimension drawn on its own from a hash
+ *
+ */
+class independent_sampler : public sampler {
+ public:
+  double get1d(uint64_t pixel, uint32_t index, uint32_t dim) const override {
+    return unit_64(hash_seed(pixel, index, dim));
+  }
+
+  void get2d(uint64_t pixel,
+             uint32_t index,
+             uint32_t dim,
+             double& x,
+             double& y) const override {
+    x = get1d(pixel, index, dim);
+    y = get1d(pixel, index, dim + 1);
+  }
+};
+
+/**
+ * @brief Jittered strata, n of them for n samples per pixel
+ * @details Pairs of dimensions use correlated multi-jittered sampling
+ * (Kensler): a grid of about sqrt(n) by sqrt(n) cells with one sample in
+ * each, whose projection on either axis also puts one sample in each of n
+ * strata. The order of the strata is shuffled per pixel and dimension.
+ * Samples past the n-th start a new, differently shuffled, set of strata.
+ *
+ */
+class stratified_sampler : public sampler {
+ public:
+  /**
+   * @brief Construct a new stratified sampler object
+   *
+   * @param n Number of samples per pixel
+   */
+  explicit stratified_sampler(int n)
+      : n_(static_cast<uint32_t>(n > 0 ? n : 1)) {
+    m_ = static_cast<uint32_t>(std::sqrt(static_cast<double>(n_)));
+    if (m_ < 1)
+      m_ = 1;
+  }
+
+  double get1d(uint64_t pixel, uint32_t index, uint32_t dim) const override {
+    const uint64_t h = hash_seed(pixel, index / n_, dim);
+    const uint32_t p = static_cast<uint32_t>(h);
+    const uint32_t s = permute(index % n_, n_, p);
+    return (s + unit_32(hash_32(static_cast<uint32_t>(h >> 32) ^ index))) /
+           n_;
+  }
+
+  void get2d(uint64_t pixel,
+             uint32_t index,
+             uint32_t dim,
+             double& x,
+             double& y) const override {
+    const uint64_t h = hash_seed(pixel, index / n_, dim);
+    const uint32_t p = static_cast<uint32_t>(h);
+    const uint32_t n = (n_ + m_ - 1) / m_;
+    const uint32_t s = permute(index % n_, n_, p * 0x51633e2du);
+    const uint32_t sx = permute(s % m_, m_, p * 0x68bc21ebu);
+    const uint32_t sy = permute(s / m_, n, p * 0x02e5be93u);
+    const double jx = unit_32(hash_32(s ^ p * 0x967a889bu));
+    const double jy = unit_32(hash_32(s ^ p * 0x368cc8b7u));
+    x = (sx + (sy + jx) / n) / m_;
+    y = (s + jy) / n_;
+  }
+
+ private:
+  /**
+   * @brief Hash of 32 bits, for the jitter within a stratum
+   *
+   */
+  static uint32_t hash_32(uint32_t x) {
+    return static_cast<uint32_t>(mix64(x) >> 32);
+  }
+
+  /**
+   * @brief Number of strata and columns of the 2d grid
+   *
+   */
+  uint32_t n_, m_;
+};
+
+/**
+ * @brief First two dimensions of the Sobol sequence, Owen scrambled
+ * @details Every pair of dimensions of a path takes the 2d Sobol points
+ * with a scrambling of its own, and the order of the points is shuffled per
+ * pixel and dimension as well (Burley), so dimensions aren't correlated with
+ * each other and any number of them can be drawn. Single dimensions use the
+ * scrambled van der Corput sequence. Sample counts that are powers of two
+ * are the best spread.
+ *
+ */
+class sobol_sampler : public sampler {
+ public:
+  double get1d(uint64_t pixel, uint32_t index, uint32_t dim) const override {
+    const uint64_t h = hash_seed(pixel, dim);
+    const uint32_t i = owen_scramble(index, static_cast<uint32_t>(h));
+    return unit_32(owen_scramble(reverse_bits(i),
+                                 static_cast<uint32_t>(h >> 32)));
+  }
+
+  void get2d(uint64_t pixel,
+             uint32_t index,
+             uint32_t dim,
+             double& x,
+             double& y) const override {
+    const uint64_t h = hash_seed(pixel, dim);
+    const uint64_t k = mix64(h);
+    const uint32_t i = owen_scramble(index, static_cast<uint32_t>(h));
+    x = unit_32(owen_scramble(reverse_bits(i), static_cast<uint32_t>(h >> 32)));
+    y = unit_32(owen_scramble(sobol_1(i), static_cast<uint32_t>(k)));
+  }
+
+ private:
+  /**
+   * @brief Second dimension of the Sobol sequence, as fraction bits
+   * @details Its generator matrix is Pascal's triangle mod 2, so each
+   * direction number is the last one xor'd with itself shifted by one.
+   *
+   */
+  static uint32_t sobol_1(uint32_t i) {
+    uint32_t x = 0;
+    for (uint32_t v = 0x80000000u; i; i >>= 1, v ^= v >> 1)
+      if (i & 1)
+        x ^= v;
+    return x;
+  }
+};
+
+/**
+ * @brief Halton sequence, one prime base per dimension, Owen scrambled
+ * @details Digits are scrambled by a permutation picked from a hash of the
+ * pixel, the dimension and the digits above them. The sequence degrades in
+ * high bases, so dimensions past the table of primes are drawn
+ * independently.
+ *
+ */
+class halton_sampler : public sampler {
+ public:
+  /**
+   * @brief Construct a new halton sampler object
+   *
+   * @param dims Number of dimensions with a prime base of their own
+   */
+  explicit halton_sampler(size_t dims = 128) {
+    for (uint32_t c = 2; primes_.size() < dims; c++) {
+      bool prime = true;
+      for (uint32_t p : primes_) {
+        if (p * p > c)
+          break;
+        if (c % p == 0) {
+          prime = false;
+          break;
+        }
+      }
+      if (prime)
+        primes_.push_back(c);
+    }
+  }
+
+  double get1d(uint64_t pixel, uint32_t index, uint32_t dim) const override {
+    const uint64_t seed = hash_seed(pixel, dim);
+    if (dim >= primes_.size())
+      return unit_64(mix64(seed ^ index));
+    return radical_inverse(index, primes_[dim], seed);
+  }
+
+  void get2d(uint64_t pixel,
+             uint32_t index,
+             uint32_t dim,
+             double& x,
+             double& y) const override {
+    x = get1d(pixel, index, dim);
+    y = get1d(pixel, index, dim + 1);
+  }
+
+ private:
+  /**
+   * @brief Owen scrambled radical inverse of a in base b
+   * @details Once the digits of a run out the rest are all zero, and
+   * scrambling those gives a uniform number below the last digit, which is
+   * drawn in one go.
+   *
+   */
+  static double radical_inverse(uint32_t a, uint32_t b, uint64_t seed) {
+    const double inv = 1.0 / b;
+    double f = inv;
+    double v = 0;
+    uint64_t h = seed;
+    while (a > 0) {
+      const uint32_t d = a % b;
+      a /= b;
+      v += permute(d, b, static_cast<uint32_t>(mix64(h))) * f;
+      f *= inv;
+      h = mix64(h ^ (d + 1));
+    }
+    return std::min(v + unit_64(mix64(h)) * f * b, 1.0 - 0x1p-53);
+  }
+
+  /**
+   * @brief Base of every dimension
+   *
+   */
+  std::vector<uint32_t> primes_;
+};
+
+/**
+ * @brief Make a sampler of a kind
+ *
+ * @param k Kind of sampler
+ * @param ns Number of samples per pixel
+ * @return std::unique_ptr<sampler> The sampler
+ */
+inline std::unique_ptr<sampler> make_sampler(sampler_kind k, int ns) {
+  switch (k) {
+    case sampler_kind::stratified:
+      return std::unique_ptr<sampler>(new stratified_sampler(ns));
+    case sampler_kind::sobol:
+      return std::unique_ptr<sampler>(new sobol_sampler());
+    case sampler_kind::halton:
+      return std::unique_ptr<sampler>(new halton_sampler());
+    default:
+      return std::unique_ptr<sampler>(new independent_sampler());
+  }
+}
+
+/**
+ * @brief Numbers of one path, read in order dimension by dimension
+ *
+ */
+class sample_stream {
+ public:
+  /**
+   * @brief Construct a new sample stream object at the first dimension
+   *
+   * @param s Sampler to read from
+   * @param pixel Index of the pixel
+   * @param index Index of the sample within the pixel
+   */
+  sample_stream(const sampler& s, uint64_t pixel, uint32_t index)
+      : s_(&s), pixel_(pixel), index_(index) {}
+
+  /**
+   * @brief Number of the next dimension
+   *
+   * @return double Number in [0,1)
+   */
+  double get1d() { return s_->get1d(pixel_, index_, dim_++); }
+
+  /**
+   * @brief Point of the next two dimensions
+   *
+   * @param x First coordinate in [0,1)
+   * @param y Second coordinate in [0,1)
+   */
+  void get2d(double& x, double& y) {
+    s_->get2d(pixel_, index_, dim_, x, y);
+    dim_ += 2;
+  }
+
+  /**
+   * @brief Pass over dimensions that aren't needed, so later ones line up
+   * with the same dimensions of the other samples of the pixel
+   *
+   * @param n Number of dimensions
+   */
+  void skip(uint32_t n) { dim_ += n; }
+
+ private:
+  const sampler* s_;
+  uint64_t pixel_;
+  uint32_t index_;
+  uint32_t dim_{0};
+};
@@ -0,0 +1,282 @@
+/**
+ * @file shard.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Splitting a render over processes and machines through a shared
+ * directory
+ * @details The image is cut into windows, one empty job file per window in
+ * todo/, named after the window. A worker claims a job by renaming it into
+ * claimed/ under its own name: rename is atomic, so of two workers going
+ * for the same job one wins and the other moves on. The finished window is
+ * written to done/ as a tile file (see tile_file.hpp) and the claim is
+ * removed. Any directory every process can reach works, on one machine or
+ * over a network file system, and no other scheduler is needed.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "io/tile_file.hpp"
+#include "render/framebuffer.hpp"
+#include "render/renderer.hpp"
+
+/**
+ * @brief Make a tile of the window of a framebuffer
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ * @param fb Framebuffer holding the window
+ * @param width Width of the whole image
+ * @param height Height of the whole image
+ * @param config Fingerprint of the settings
+ * @return image_tile Tile of the window
+ */
+template <typename T>
+image_tile make_tile(const framebuffer<T>& fb,
+                     const int& width,
+                     const int& height,
+                     const uint64_t& config) {
+  image_tile t;
+  t.width = width;
+  t.height = height;
+  t.x0 = fb.x0();
+  t.y0 = height - (fb.y0() + fb.height());
+  t.x1 = t.x0 + fb.width();
+  t.y1 = t.y0 + fb.height();
+  t.config = config;
+  t.rgb = fb.resolve().rgb;
+  t.spp.reserve(t.rgb.size() / 3);
+  for (int j = fb.y0() + fb.height() - 1; j >= fb.y0(); --j)
+    for (int i = fb.x0(); i < fb.x0() + fb.width(); ++i)
+      t.spp.push_back(static_cast<uint32_t>(fb.samples(i, j)));
+  return t;
+}
+
+/**
+ * @brief Queue of the windows of a render, kept in a shared directory
+ * @details Windows are given as tiles with columns and rows from the top
+ * left corner of the image, as in tile files.
+ *
+ */
+class shard_queue {
+ public:
+  /**
+   * @brief Construct a new shard queue object over a directory
+   *
+   * @param dir Directory of the queue, made if missing
+   */
+  explicit shard_queue(const std::string& dir) : dir_(dir) {
+    std::error_code ec;
+    for (const char* sub : {"todo", "claimed", "done"})
+      std::filesystem::create_directories(dir_ / sub, ec);
+    char host[256] = "host";
+    gethostname(host, sizeof(host) - 1);
+    me_ = std::string(host) + "." + std::to_string(getpid());
+  }
+
+  /**
+   * @brief Queue every window of an image, unless the queue already holds
+   * jobs of a render
+   *
+   * @param width Width of the image
+   * @param height Height of the image
+   * @param size Edge length of a window in pixels
+   * @return size_t Number of windows queued, 0 if the queue was in use
+   */
+  size_t create(const int& width, const int& height, const int& size) {
+    for (const char* sub : {"todo", "claimed", "done"})
+      if (!empty(dir_ / sub))
+        return 0;
+    size_t n = 0;
+    for (const tile& w : make_tiles(width, height, size)) {
+      // Rows from the top, as tile files count them
+      const tile win{w.x0, height - w.y1, w.x1, height - w.y0};
+      std::FILE* f = std::fopen((dir_ / "todo" / name(win)).c_str(), "w");
+      if (f) {
+        std::fclose(f);
+        n++;
+      }
+    }
+    return n;
+  }
+
+  /**
+   * @brief Claim a window to render
+   *
+   * @param win Window claimed
+   * @return true A window was claimed
+   * @return false No window is left to claim
+   */
+  bool claim(tile& win) {
+    std::error_code ec;
+    for (const auto& e : std::filesystem::directory_iterator(dir_ / "todo",
+                                                             ec)) {
+      const std::string job = e.path().filename().string();
+      const std::filesystem::path mine =
+          dir_ / "claimed" / (job + "@" + me_);
+      if (!parse(job, win))
+        continue;
+      // The age of a claim is counted from now, see requeue_stale. The job
+      // is touched before it moves: touched after, a requeue_stale running
+      // in between would see the age of the job in todo/ and take it back.
+      std::filesystem::last_write_time(
+          e.path(), std::filesystem::file_time_type::clock::now(), ec);
+      if (std::rename(e.path().c_str(), mine.c_str()) != 0)
+        continue;
+      claim_ = mine;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Hand in the tile of the window claimed last
+   *
+   * @param t Tile of the window
+   * @return true The tile is in done/
+   * @return false It couldn't be written, the window stays claimed
+   */
+  bool finish(const image_tile& t) {
+    const tile win{t.x0, t.y0, t.x1, t.y1};
+    const std::string path =
+        (dir_ / "done" / (name(win) + ".rtile")).string();
+    // A window requeued while its worker was still at it may be finished
+    // twice at once, each writes its own temporary
+    if (!save_tile(path, t, path + "." + me_ + ".tmp"))
+      return false;
+    std::error_code ec;
+    std::filesystem::remove(claim_, ec);
+    claim_.clear();
+    return true;
+  }
+
+  /**
+   * @brief Give back the window claimed last, unfinished
+   *
+   */
+  void release() {
+    if (claim_.empty())
+      return;
+    const std::string job = claim_.filename().string();
+    std::rename(claim_.c_str(),
+                (dir_ / "todo" / job.substr(0, job.find('@'))).c_str());
+    claim_.clear();
+  }
+
+  /**
+   * @brief Queue again the windows claimed too long ago, their worker is
+   * taken to be gone
+   *
+   * @param seconds Age of a claim past which it is queued again
+   * @return size_t Number of windows queued again
+   */
+  size_t requeue_stale(const double& seconds) {
+    using clock = std::filesystem::file_time_type::clock;
+    std::error_code ec;
+    size_t n = 0;
+    const auto now = clock::now();
+    for (const auto& e : std::filesystem::directory_iterator(
+             dir_ / "claimed", ec)) {
+      const auto t = std::filesystem::last_write_time(e.path(), ec);
+      if (ec || std::chrono::duration<double>(now - t).count() < seconds)
+        continue;
+      const std::string job = e.path().filename().string();
+      if (std::rename(e.path().c_str(),
+                      (dir_ / "todo" / job.substr(0, job.find('@')))
+                          .c_str()) == 0)
+        n++;
+    }
+    return n;
+  }
+
+  /**
+   * @brief Return the number of windows not done yet
+   *
+   * @return size_t Windows queued or claimed
+   */
+  size_t waiting() const {
+    return count(dir_ / "todo") + count(dir_ / "claimed");
+  }
+
+  /**
+   * @brief Return the tile files of the windows done
+   *
+   * @return std::vector<std::string> Paths of the tiles
+   */
+  std::vector<std::string> done() const {
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (const auto& e :
+         std::filesystem::directory_iterator(dir_ / "done", ec))
+      if (e.path().extension() == ".rtile")
+        out.push_back(e.path().string());
+    return out;
+  }
+
+ private:
+  /**
+   * @brief Name of the job of a window
+   *
+   */
+  static std::string name(const tile& w) {
+    return std::to_string(w.x0) + "_" + std::to_string(w.y0) + "_" +
+           std::to_string(w.x1) + "_" + std::to_string(w.y1);
+  }
+
+  /**
+   * @brief Window of a job name
+   *
+   */
+  static bool parse(const std::string& job, tile& w) {
+    char rest;
+    return std::sscanf(job.c_str(), "%d_%d_%d_%d%c", &w.x0, &w.y0, &w.x1,
+                       &w.y1, &rest) == 4 &&
+           w.x0 < w.x1 && w.y0 < w.y1;
+  }
+
+  /**
+   * @brief Number of entries of a directory
+   *
+   */
+  static size_t count(const std::filesystem::path& p) {
+    std::error_code ec;
+    size_t n = 0;
+    for (auto it = std::filesystem::directory_iterator(p, ec);
+         !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+      n++;
+    return n;
+  }
+
+  /**
+   * @brief Whether a directory has no entries
+   *
+   */
+  static bool empty(const std::filesystem::path& p) { return count(p) == 0; }
+
+  /**
+   * @brief Directory of the queue
+   *
+   */
+  std::filesystem::path dir_;
+  /**
+   * @brief Name of this worker: host and process
+   *
+   */
+  std::string me_;
+  /**
+   * @brief Claim of the window being rendered, empty when none
+   *
+   */
+  std::filesystem::path claim_;
+};
@@ -0,0 +1,249 @@
+/**
+ * @file thread_pool.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Work-stealing thread pool used to spread tiles over every core
+ * @details Every worker owns a deque of job indices. A worker pops jobs from
+ * the front of its own deque and, once that runs dry, steals from the back of
+ * another worker's deque. Jobs are handed out in contiguous runs so
+ * neighbouring tiles stay on the same core until the load becomes uneven.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Pool of persistent worker threads with per-worker job deques
+ *
+ */
+class thread_pool {
+ public:
+  /**
+   * @brief Construct a new thread pool object
+   *
+   * @param n Number of workers, 0 uses every hardware thread
+   */
+  explicit thread_pool(unsigned n = 0) {
+    if (n == 0)
+      n = std::thread::hardware_concurrency();
+    if (n == 0)
+      n = 1;
+
+    for (unsigned i = 0; i < n; i++)
+      queues_.push_back(std::make_unique<worker_queue>());
+    // The calling thread acts as worker 0, so only spawn the rest
+    for (unsigned i = 1; i < n; i++)
+      threads_.emplace_back(&thread_pool::worker_loop, this, i);
+  }
+
+  /**
+   * @brief Destroy the thread pool object, joining every worker
+   *
+   */
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+      ++generation_;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_)
+      t.join();
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  /**
+   * @brief Return the number of workers, including the calling thread
+   *
+   * @return size_t Number of workers
+   */
+  size_t size() const { return queues_.size(); }
+
+  /**
+   * @brief Run job(i, worker) for every i in [0, n) and block until done
+   *
+   * @param n Number of jobs
+   * @param job Function taking the job index and the worker index
+   */
+  void run(size_t n, const std::function<void(size_t, size_t)>& job) {
+    if (n == 0)
+      return;
+
+    // Hand each worker a contiguous run of jobs
+    const size_t w = size();
+    for (size_t i = 0; i < w; i++) {
+      worker_queue& q = *queues_[i];
+      std::lock_guard<std::mutex> lock(q.mtx);
+      for (size_t j = (n * i) / w; j < (n * (i + 1)) / w; j++)
+        q.jobs.push_back(j);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      job_ = &job;
+      remaining_ = n;
+      ++generation_;
+    }
+    wake_.notify_all();
+
+    work(0);
+
+    // Wait for stragglers too, they must not see the next batch's jobs
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_.wait(lock, [this] { return remaining_ == 0 && active_ == 0; });
+    job_ = nullptr;
+  }
+
+ private:
+  /**
+   * @brief Job deque owned by a single worker
+   *
+   */
+  struct worker_queue {
+    std::mutex mtx;
+    std::deque<size_t> jobs;
+  };
+
+  /**
+   * @brief Take a job, first from our own deque then by stealing
+   *
+   * @param id Index of the worker
+   * @param out Index of the job taken
+   * @return true A job was found
+   * @return false Every deque is empty
+   */
+  bool take(size_t id, size_t& out) {
+    {
+      worker_queue& q = *queues_[id];
+      std::lock_guard<std::mutex> lock(q.mtx);
+      if (!q.jobs.empty()) {
+        out = q.jobs.front();
+        q.jobs.pop_front();
+        return true;
+      }
+    }
+
+    // Steal from the far end of a victim so we don't fight over its next job
+    const size_t w = size();
+    for (size_t k = 1; k < w; k++) {
+      worker_queue& q = *queues_[(id + k) % w];
+      std::lock_guard<std::mutex> lock(q.mtx);
+      if (!q.jobs.empty()) {
+        out = q.jobs.back();
+        q.jobs.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Drain jobs until every deque is empty
+   *
+   * @param id Index of the worker
+   */
+  void work(size_t id) {
+    const std::function<void(size_t, size_t)>* job;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      job = job_;
+      if (!job)
+        return;
+      ++active_;
+    }
+
+    size_t i;
+    while (take(id, i)) {
+      (*job)(i, id);
+      std::lock_guard<std::mutex> lock(mtx_);
+      --remaining_;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (--active_ == 0 && remaining_ == 0)
+      done_.notify_all();
+  }
+
+  /**
+   * @brief Main loop of a spawned worker
+   *
+   * @param id Index of the worker
+   */
+  void worker_loop(size_t id) {
+    size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mtx_);
+        wake_.wait(lock, [&] { return generation_ != seen; });
+        seen = generation_;
+        if (stop_)
+          return;
+      }
+      work(id);
+    }
+  }
+
+  /**
+   * @brief Per-worker job deques
+   *
+   */
+  std::vector<std::unique_ptr<worker_queue>> queues_;
+  /**
+   * @brief Spawned worker threads
+   *
+   */
+  std::vector<std::thread> threads_;
+  /**
+   * @brief Guards the job pointer, counters and stop flag
+   *
+   */
+  std::mutex mtx_;
+  /**
+   * @brief Wakes the workers for a new batch
+   *
+   */
+  std::condition_variable wake_;
+  /**
+   * @brief Signals the caller that the batch is complete
+   *
+   */
+  std::condition_variable done_;
+  /**
+   * @brief Job of the current batch
+   *
+   */
+  const std::function<void(size_t, size_t)>* job_{nullptr};
+  /**
+   * @brief Number of jobs left in the current batch
+   *
+   */
+  size_t remaining_{0};
+  /**
+   * @brief Number of workers currently draining the batch
+   *
+   */
+  size_t active_{0};
+  /**
+   * @brief Batch counter, bumped to wake the workers
+   *
+   */
+  size_t generation_{0};
+  /**
+   * @brief Whether the pool is shutting down
+   *
+   */
+  bool stop_{false};
+};
@@ -0,0 +1,207 @@
+/**
+ * @file rng.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Small, fast random number engines and seed hashing
+ * @details std::rand is slow, shares one global state between every thread and
+ * only guarantees 15 bits. These engines are a handful of bytes each, so every
+ * path can own one. Define rng_engine before including to swap the engine
+ * used across the tracer, the same way datatype swaps the float type.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Finalizer of splitmix64, scrambles every bit of the input
+ *
+ * @param x Value to scramble
+ * @return uint64_t Scrambled value
+ */
+inline uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief Hash up to three integers into one seed
+ *
+ * @param a First value (e.g pixel index)
+ * @param b Second value (e.g sample index)
+ * @param c Third value (e.g dimension)
+ * @return uint64_t Seed
+ */
+inline uint64_t hash_seed(uint64_t a, uint64_t b = 0, uint64_t c = 0) {
+  return mix64(mix64(mix64(a) ^ b) ^ c);
+}
+
+/**
+ * @brief PCG32 engine (O'Neill, XSH-RR output), 64 bits of state
+ *
+ */
+class pcg32 {
+ public:
+  /**
+   * @brief Construct a new pcg32 object with the reference seed
+   *
+   */
+  pcg32() { seed(0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL); }
+  /**
+   * @brief Construct a new pcg32 object
+   *
+   * @param s Initial state
+   * @param stream Stream selector, different streams never overlap
+   */
+  explicit pcg32(uint64_t s, uint64_t stream = 0) { seed(s, stream); }
+
+  /**
+   * @brief Reseed the engine
+   *
+   * @param s Initial state
+   * @param stream Stream selector, different streams never overlap
+   */
+  void seed(uint64_t s, uint64_t stream = 0) {
+    state_ = 0;
+    inc_ = (stream << 1) | 1;
+    next();
+    state_ += s;
+    next();
+  }
+
+  /**
+   * @brief Return the next 32 random bits
+   *
+   * @return uint32_t Random bits
+   */
+  uint32_t next() {
+    uint64_t old = state_;
+    state_ = old * 6364136223846793005ULL + inc_;
+    uint32_t shifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    uint32_t rot = static_cast<uint32_t>(old >> 59);
+    return (shifted >> rot) | (shifted << ((~rot + 1) & 31));
+  }
+
+  /**
+   * @brief Return a random double in [0,1)
+   *
+   * @return double Random number in [0,1)
+   */
+  double uniform() {
+    // Scale by 2^-32
+    return next() * 2.3283064365386963e-10;
+  }
+
+ private:
+  /**
+   * @brief Current state and odd stream increment
+   *
+   */
+  uint64_t state_, inc_;
+};
+
+/**
+ * @brief xoshiro256++ engine (Blackman & Vigna), 256 bits of state
+ *
+ */
+class xoshiro256pp {
+ public:
+  /**
+   * @brief Construct a new xoshiro256pp object with a fixed seed
+   *
+   */
+  xoshiro256pp() { seed(0); }
+  /**
+   * @brief Construct a new xoshiro256pp object
+   *
+   * @param s Seed
+   * @param stream Stream selector, hashed into the seed
+   */
+  explicit xoshiro256pp(uint64_t s, uint64_t stream = 0) { seed(s, stream); }
+
+  /**
+   * @brief Reseed the engine, expanding the seed with splitmix64
+   *
+   * @param s Seed
+   * @param stream Stream selector, hashed into the seed
+   */
+  void seed(uint64_t s, uint64_t stream = 0) {
+    uint64_t x = s ^ mix64(stream);
+    for (int i = 0; i < 4; i++) {
+      x += 0x9e3779b97f4a7c15ULL;
+      s_[i] = mix64(x);
+    }
+  }
+
+  /**
+   * @brief Return the next 64 random bits
+   *
+   * @return uint64_t Random bits
+   */
+  uint64_t next() {
+    const uint64_t out = rotl(s_[0] + s_[3], 23) + s_[0];
+    const uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+    return out;
+  }
+
+  /**
+   * @brief Return a random double in [0,1)
+   *
+   * @return double Random number in [0,1)
+   */
+  double uniform() {
+    // Keep the top 53 bits, scale by 2^-53
+    return (next() >> 11) * 1.1102230246251565e-16;
+  }
+
+ private:
+  /**
+   * @brief Rotate bits left
+   *
+   * @param x Value to rotate
+   * @param k Number of bits
+   * @return uint64_t Rotated value
+   */
+  static uint64_t rotl(const uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  /**
+   * @brief Engine state
+   *
+   */
+  uint64_t s_[4];
+};
+
+#ifndef rng_engine
+#define rng_engine pcg32
+#endif
+
+/**
+ * @brief Engine used by the tracer
+ *
+ */
+using rng = rng_engine;
+
+/**
+ * @brief Return this thread's engine
+ * @details Used by scene construction and anything that cannot be handed an
+ * engine (e.g iso_fog inside is_hit). The renderer reseeds it for every path.
+ *
+ * @return rng& Engine owned by the calling thread
+ */
+inline rng& thread_rng() {
+  thread_local rng g;
+  return g;
+}
@@ -23,38 +23,27 @@
 #include "objects/sphere.hpp"
 #include "objects/translation.hpp"
 #include "objects/y_rotation.hpp"
+#include "scenes/scene.hpp"
 #include "textures/checker.hpp"
 
 #ifndef datatype
 #define datatype double
 #endif
 
-// Colours
-auto red = std::make_shared<diffuse<datatype>>(color<datatype>(.65, .05, .05));
-auto white =
-    std::make_shared<diffuse<datatype>>(color<datatype>(.73, .73, .73));
-auto green =
-    std::make_shared<diffuse<datatype>>(color<datatype>(.12, .45, .15));
-
-// Lights
-auto light =
-    std::make_shared<diffuse_light<datatype>>(color<datatype>(15, 15, 15));
-
-// Textures
-auto mat_checker =
-    std::make_shared<checker<datatype>>(color<datatype>(0.2, 0.3, 0.1),
-                                        color<datatype>(0.9, 0.9, 0.9));
-
 /**
  * @brief Construct a hit list containing our scene to render
  *
+ * @param sc Scene that owns the objects
  * @return hit_list<datatype> Our combined scene to render
  */
-hit_list<datatype> light_scene() {
+hit_list<datatype> light_scene(scene<datatype>& sc) {
   hit_list<datatype> floor;
 
+  // Lights
+  auto light = sc.make<diffuse_light<datatype>>(color<datatype>(15, 15, 15));
+
   auto mat_ground =
-      std::make_shared<diffuse<datatype>>(color<datatype>(0.45, 0.36, 0.83));
+      sc.make<diffuse<datatype>>(color<datatype>(0.45, 0.36, 0.83));
 
   const int n_box = 20;
   for (int i = 0; i < n_box; i++) {
@@ -67,17 +56,17 @@ hit_list<datatype> light_scene() {
       datatype y1 = random_double(1, 101);
       datatype z1 = z0 + w;
 
-      floor.add(std::make_shared<cube<datatype>>(point3<datatype>(x0, y0, z0),
-                                                 point3<datatype>(x1, y1, z1),
-                                                 mat_ground));
+      floor.add(sc.make<cube<datatype>>(point3<datatype>(x0, y0, z0),
+                                        point3<datatype>(x1, y1, z1),
+                                        mat_ground));
     }
   }
 
   hit_list<datatype> objects;
-  objects.add(std::make_shared<bvh_node<datatype>>(floor, 0, 1));
+  objects.add(sc.make<bvh_node<datatype>>(floor, 0, 1, sc.mem()));
 
-  objects.add(std::make_shared<xz_rectangle<datatype>>(1.2, 4.2, 1.5, 4.1, 5.54,
-                                                       light));
+  objects.add(
+      sc.make<xz_rectangle<datatype>>(1.2, 4.2, 1.5, 4.1, 5.54, light));
 
   point3<datatype> c0 = point3<datatype>(4, 4, 4);
   point3<datatype> c1 = c0 + point3<datatype>(0.3, 0, 0);
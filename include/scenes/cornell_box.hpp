@@ -23,45 +23,62 @@
 #include "objects/translation.hpp"
 #include "objects/triangle.hpp"
 #include "objects/y_rotation.hpp"
+#include "scenes/scene.hpp"
 #include "textures/checker.hpp"
 
-// Colours
-auto red = std::make_shared<diffuse<datatype>>(color<datatype>(.65, .05, .05));
-auto white =
-    std::make_shared<diffuse<datatype>>(color<datatype>(.73, .73, .73));
-auto green =
-    std::make_shared<diffuse<datatype>>(color<datatype>(.12, .45, .15));
-
-// Lights
-auto light = std::make_shared<diffuse_light<datatype>>(
-    color<datatype>(26.656, 15.375, 3.5625));
+/**
+ * @brief Materials shared by the Cornell Box scenes
+ *
+ */
+struct cornell_materials {
+  const material<datatype>* red;
+  const material<datatype>* white;
+  const material<datatype>* green;
+  const material<datatype>* light;
+};
 
-// Textures
-auto mat_checker =
-    std::make_shared<checker<datatype>>(color<datatype>(0.2, 0.3, 0.1),
-                                        color<datatype>(0.9, 0.9, 0.9));
+/**
+ * @brief Make the materials of the Cornell Box in a scene
+ *
+ * @param sc Scene that owns the materials
+ * @return cornell_materials Colours and light of the box
+ */
+cornell_materials make_cornell_materials(scene<datatype>& sc) {
+  cornell_materials m;
+  // Colours
+  m.red = sc.make<diffuse<datatype>>(color<datatype>(.65, .05, .05));
+  m.white = sc.make<diffuse<datatype>>(color<datatype>(.73, .73, .73));
+  m.green = sc.make<diffuse<datatype>>(color<datatype>(.12, .45, .15));
+
+  // Lights
+  m.light = sc.make<diffuse_light<datatype>>(
+      color<datatype>(26.656, 15.375, 3.5625));
+  return m;
+}
 
 // Just an empty cornell box
 /**
  * @brief Construct an empty cornell box
  *
+ * @param sc Scene that owns the objects
+ * @param m Materials of the box
  * @return hit_list<datatype> Hit list containing empty Cornell Box
  */
-hit_list<datatype> empty_cornell_box() {
+hit_list<datatype> empty_cornell_box(scene<datatype>& sc,
+                                     const cornell_materials& m) {
   hit_list<datatype> objects;
 
   objects.add(
-      std::make_shared<yz_rectangle<datatype>>(0, 548.8, 0, 559.2, 556, red));
+      sc.make<yz_rectangle<datatype>>(0, 548.8, 0, 559.2, 556, m.red));
   objects.add(
-      std::make_shared<yz_rectangle<datatype>>(0, 548.8, 0, 559.2, 0, green));
-  objects.add(std::make_shared<xz_rectangle<datatype>>(213, 343, 227, 332,
-                                                       548.7, light));
+      sc.make<yz_rectangle<datatype>>(0, 548.8, 0, 559.2, 0, m.green));
   objects.add(
-      std::make_shared<xz_rectangle<datatype>>(0, 556, 0, 559.2, 0, white));
+      sc.make<xz_rectangle<datatype>>(213, 343, 227, 332, 548.7, m.light));
+  objects.add(sc.make<xz_rectangle<datatype>>(0, 556, 0, 559.2, 0, m.white));
   objects.add(
-      std::make_shared<xz_rectangle<datatype>>(0, 556, 0, 559.2, 548.8, white));
+      sc.make<xz_rectangle<datatype>>(0, 556, 0, 559.2, 548.8, m.white));
   objects.add(
-      std::make_shared<xy_rectangle<datatype>>(0, 556, 0, 548.8, 559.2, white));
+      sc.make<xy_rectangle<datatype>>(0, 556, 0, 548.8, 559.2, m.white));
 
   return objects;
 }
@@ -70,77 +87,81 @@ hit_list<datatype> empty_cornell_box() {
 /**
  * @brief Add the standard objects to our empty cornell box
  *
+ * @param sc Scene that owns the objects
  * @return hit_list<datatype> Hit list containing standard cornell box
  */
-hit_list<datatype> standard_cornell_box() {
-  hit_list<datatype> objects = empty_cornell_box();
+hit_list<datatype> standard_cornell_box(scene<datatype>& sc) {
+  const cornell_materials m = make_cornell_materials(sc);
+  hit_list<datatype> objects = empty_cornell_box(sc, m);
 
-  std::shared_ptr<hit<datatype>> b1 = std::make_shared<cube<datatype>>(
-      point3<datatype>(0, 0, 0), point3<datatype>(165, 330, 165), white);
+  const hit<datatype>* b1 = sc.make<cube<datatype>>(
+      point3<datatype>(0, 0, 0), point3<datatype>(165, 330, 165), m.white);
 
-  b1 = std::make_shared<y_rotation<datatype>>(b1, 15);
-  b1 = std::make_shared<translate<datatype>>(b1, vec3<datatype>(265, 0, 295));
+  b1 = sc.make<y_rotation<datatype>>(b1, 15);
+  b1 = sc.make<translate<datatype>>(b1, vec3<datatype>(265, 0, 295));
 
   objects.add(b1);
 
-  std::shared_ptr<hit<datatype>> b2 = std::make_shared<cube<datatype>>(
-      point3<datatype>(0, 0, 0), point3<datatype>(165, 165, 165), white);
-  b2 = std::make_shared<y_rotation<datatype>>(b2, -18);
-  b2 = std::make_shared<translate<datatype>>(b2, vec3<datatype>(130, 0, 65));
+  const hit<datatype>* b2 = sc.make<cube<datatype>>(
+      point3<datatype>(0, 0, 0), point3<datatype>(165, 165, 165), m.white);
+  b2 = sc.make<y_rotation<datatype>>(b2, -18);
+  b2 = sc.make<translate<datatype>>(b2, vec3<datatype>(130, 0, 65));
 
   objects.add(b2);
 
   return hit_list<datatype>(
-      std::make_shared<bvh_node<datatype>>(objects, 0.0, 1.0));
+      sc.make<bvh_node<datatype>>(objects, 0.0, 1.0, sc.mem()));
 }
 
 /**
  * @brief Construct a standard cornell box, but with fog cubes.
  *
+ * @param sc Scene that owns the objects
  * @return hit_list<datatype> Hit list containing our foggy Cornell Box
  */
-hit_list<datatype> fog_cornell_box() {
-  hit_list<datatype> objects = empty_cornell_box();
+hit_list<datatype> fog_cornell_box(scene<datatype>& sc) {
+  const cornell_materials m = make_cornell_materials(sc);
+  hit_list<datatype> objects = empty_cornell_box(sc, m);
 
-  std::shared_ptr<hit<datatype>> b1 = std::make_shared<cube<datatype>>(
-      point3<datatype>(0, 0, 0), point3<datatype>(165, 330, 165), white);
+  const hit<datatype>* b1 = sc.make<cube<datatype>>(
+      point3<datatype>(0, 0, 0), point3<datatype>(165, 330, 165), m.white);
 
-  b1 = std::make_shared<y_rotation<datatype>>(b1, 15);
-  b1 = std::make_shared<translate<datatype>>(b1, vec3<datatype>(265, 0, 295));
+  b1 = sc.make<y_rotation<datatype>>(b1, 15);
+  b1 = sc.make<translate<datatype>>(b1, vec3<datatype>(265, 0, 295));
 
   objects.add(
-      std::make_shared<iso_fog<datatype>>(b1, 0.01, color<datatype>(1, 1, 1)));
+      sc.make<iso_fog<datatype>>(b1, 0.01, color<datatype>(1, 1, 1)));
 
-  std::shared_ptr<hit<datatype>> b2 = std::make_shared<cube<datatype>>(
-      point3<datatype>(0, 0, 0), point3<datatype>(165, 165, 165), white);
-  b2 = std::make_shared<y_rotation<datatype>>(b2, -18);
-  b2 = std::make_shared<translate<datatype>>(b2, vec3<datatype>(130, 0, 65));
+  const hit<datatype>* b2 = sc.make<cube<datatype>>(
+      point3<datatype>(0, 0, 0), point3<datatype>(165, 165, 165), m.white);
+  b2 = sc.make<y_rotation<datatype>>(b2, -18);
+  b2 = sc.make<translate<datatype>>(b2, vec3<datatype>(130, 0, 65));
 
   objects.add(
-      std::make_shared<iso_fog<datatype>>(b2, 0.01, color<datatype>(1, 0, 1)));
+      sc.make<iso_fog<datatype>>(b2, 0.01, color<datatype>(1, 0, 1)));
 
   return hit_list<datatype>(
-      std::make_shared<bvh_node<datatype>>(objects, 0.0, 1.0));
+      sc.make<bvh_node<datatype>>(objects, 0.0, 1.0, sc.mem()));
 }
 
 /**
  * @brief Construct a standard cornell box, but with fog cubes.
  *
+ * @param sc Scene that owns the objects
  * @return hit_list<datatype> Hit list containing our foggy Cornell Box
  */
-hit_list<datatype> triangle_cornell_box() {
-  hit_list<datatype> objects = empty_cornell_box();
+hit_list<datatype> triangle_cornell_box(scene<datatype>& sc) {
+  const cornell_materials m = make_cornell_materials(sc);
+  hit_list<datatype> objects = empty_cornell_box(sc, m);
 
   point3<datatype> p0, p1, p2;
   p0 = point3<datatype>(556 / 3.0, 548.8 / 3.0, 559.2 / 2.0);
   p1 = point3<datatype>(556 / 3.0 * 2.0, 548.8 / 3.0, 559.2 / 3.0 * 2.0);
   p2 = point3<datatype>(556 / 2.0, 548.8 / 3.0 * 2.0, 559.2 / 3.0 * 2.0);
-  auto metal2 =
-      std::make_shared<metal<datatype>>(color<datatype>(0.1, 0.4, 0.8), 1.0);
-  objects.add(
-      std::make_shared<triangle<datatype>>(p0, p1, p2, 559.2 / 3.0, metal2));
-  //   std::make_shared<diffuse<datatype>>(mat_checker)));
+  auto metal2 = sc.make<metal<datatype>>(color<datatype>(0.1, 0.4, 0.8), 1.0);
+  objects.add(sc.make<triangle<datatype>>(p0, p1, p2, 559.2 / 3.0, metal2));
+  //   sc.make<diffuse<datatype>>(mat_checker)));
 
   return hit_list<datatype>(
-      std::make_shared<bvh_node<datatype>>(objects, 0.0, 1.0));
+      sc.make<bvh_node<datatype>>(objects, 0.0, 1.0, sc.mem()));
 }
@@ -14,44 +14,40 @@
 #include "objects/translation.hpp"
 #include "objects/triangle.hpp"
 #include "objects/y_rotation.hpp"
+#include "scenes/scene.hpp"
 #include "textures/checker.hpp"
 
 #ifndef datatype
 #define datatype double
 #endif
 
-// // Colours
-// auto red = std::make_shared<diffuse<datatype>>(color<datatype>(.65, .05,
-// .05)); auto white =
-//     std::make_shared<diffuse<datatype>>(color<datatype>(.73, .73, .73));
-// auto green =
-//     std::make_shared<diffuse<datatype>>(color<datatype>(.12, .45, .15));
-
-// // Lights
-// auto light = std::make_shared<diffuse_light<datatype>>(
-//     color<datatype>(26.656, 15.375, 3.5625));
-
-// // Textures
-auto mat_checker =
-    std::make_shared<checker<datatype>>(color<datatype>(0.2, 0.3, 0.1),
-                                        color<datatype>(0.9, 0.9, 0.9));
+/**
+ * @brief Construct a bunny mesh on a checkered floor under a light
+ *
+ * @param sc Scene that owns the objects
+ * @return hit_list<datatype> Hit list containing the scene
+ */
+hit_list<datatype> mesh_scene(scene<datatype>& sc) {
+  hit_list<datatype> objects;
 
-auto red = std::make_shared<diffuse<datatype>>(color<datatype>(.65, .05, .05));
+  // Textures
+  auto mat_checker = sc.make<checker<datatype>>(
+      color<datatype>(0.2, 0.3, 0.1), color<datatype>(0.9, 0.9, 0.9));
 
-// Lights
-auto light =
-    std::make_shared<diffuse_light<datatype>>(color<datatype>(2, 2, 2));
+  auto red = sc.make<diffuse<datatype>>(color<datatype>(.65, .05, .05));
 
-hit_list<datatype> mesh_scene() {
-  hit_list<datatype> objects;
+  // Lights
+  auto light = sc.make<diffuse_light<datatype>>(color<datatype>(2, 2, 2));
 
-  objects.add(std::make_shared<sphere<datatype>>(
+  objects.add(sc.make<sphere<datatype>>(
       point3<datatype>(0, -1000, 0), 1000,
-      std::make_shared<diffuse<datatype>>(mat_checker)));
+      sc.make<diffuse<datatype>>(mat_checker)));
 
-  objects.add(std::make_shared<xz_rectangle<datatype>>(-343, 343, -332, 332,
-                                                       548.7, light));
-  objects.add(std::make_shared<mesh<datatype>>("bunny.obj", red));
+  objects.add(
+      sc.make<xz_rectangle<datatype>>(-343, 343, -332, 332, 548.7, light));
+  auto bunny = sc.make<mesh<datatype>>("bunny.obj", red);
+  bunny->print();
+  objects.add(bunny);
 
   return objects;
-}
\ No newline at end of file
+}
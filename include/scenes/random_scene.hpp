@@ -17,23 +17,24 @@
 #include "objects/bvh.hpp"
 #include "objects/moving_sphere.hpp"
 #include "objects/sphere.hpp"
+#include "scenes/scene.hpp"
 #include "textures/checker.hpp"
 
 /**
  * @brief Construct our random scene
  *
+ * @param sc Scene that owns the objects
  * @return hit_list<datatype> Hit list containing the random scene
  */
-hit_list<datatype> random_scene() {
+hit_list<datatype> random_scene(scene<datatype>& sc) {
   hit_list<datatype> world;
 
-  auto mat_checker = std::make_shared<checker<datatype>>(
+  auto mat_checker = sc.make<checker<datatype>>(
       color<datatype>(0.2, 0.3, 0.1), color<datatype>(0.9, 0.9, 0.9));
   // auto mat_ground =
   // std::make_shared<diffuse<datatype>>(color<datatype>(0.5, 0.5, 0.5));
-  world.add(std::make_shared<sphere<datatype>>(
-      point3<datatype>(0, -1000, 0), 1000,
-      std::make_shared<diffuse<datatype>>(mat_checker)));
+  world.add(sc.make<sphere<datatype>>(point3<datatype>(0, -1000, 0), 1000,
+                                      sc.make<diffuse<datatype>>(mat_checker)));
 
   int size = 11;
 
@@ -44,45 +45,40 @@ hit_list<datatype> random_scene() {
                          j + 0.9 * random_double());
 
       if ((c - point3<datatype>(4, 0.2, 0)).norm() > 0.9) {
-        std::shared_ptr<material<datatype>> mat_sph;
+        const material<datatype>* mat_sph;
 
         if (mat_ < 0.8) {
           color<datatype> col =
               color<datatype>::random() * color<datatype>::random();
-          mat_sph = std::make_shared<diffuse<datatype>>(col);
+          mat_sph = sc.make<diffuse<datatype>>(col);
 
           point3<datatype> c2 = c + vec3<datatype>(0, random_double(0, 0.5), 0);
 
-          world.add(std::make_shared<moving_sphere<datatype>>(c, c2, 0.0, 1.0,
-                                                              0.2, mat_sph));
+          world.add(sc.make<moving_sphere<datatype>>(c, c2, 0.0, 1.0, 0.2,
+                                                     mat_sph));
         } else if (mat_ < 0.95) {
           color<datatype> col = color<datatype>::random(0.5, 1);
           datatype f = random_double(0, 0.5);
-          mat_sph = std::make_shared<metal<datatype>>(col, f);
-          world.add(std::make_shared<sphere<datatype>>(c, 0.2, mat_sph));
+          mat_sph = sc.make<metal<datatype>>(col, f);
+          world.add(sc.make<sphere<datatype>>(c, 0.2, mat_sph));
         } else {
-          mat_sph = std::make_shared<glass<datatype>>(1.5);
-          world.add(std::make_shared<sphere<datatype>>(c, 0.2, mat_sph));
+          mat_sph = sc.make<glass<datatype>>(1.5);
+          world.add(sc.make<sphere<datatype>>(c, 0.2, mat_sph));
         }
       }
     }
   }
 
-  auto mat1 = std::make_shared<glass<datatype>>(1.5);
-  auto mat2 =
-      std::make_shared<diffuse<datatype>>(color<datatype>(0.4, 0.2, 0.1));
-  auto mat3 =
-      std::make_shared<metal<datatype>>(color<datatype>(0.7, 0.6, 0.5), 0.0);
+  auto mat1 = sc.make<glass<datatype>>(1.5);
+  auto mat2 = sc.make<diffuse<datatype>>(color<datatype>(0.4, 0.2, 0.1));
+  auto mat3 = sc.make<metal<datatype>>(color<datatype>(0.7, 0.6, 0.5), 0.0);
 
-  world.add(
-      std::make_shared<sphere<datatype>>(point3<datatype>(0, 1, 0), 1.0, mat1));
-  world.add(std::make_shared<sphere<datatype>>(point3<datatype>(-4, 1, 0), 1.0,
-                                               mat2));
-  world.add(
-      std::make_shared<sphere<datatype>>(point3<datatype>(4, 1, 0), 1.0, mat3));
+  world.add(sc.make<sphere<datatype>>(point3<datatype>(0, 1, 0), 1.0, mat1));
+  world.add(sc.make<sphere<datatype>>(point3<datatype>(-4, 1, 0), 1.0, mat2));
+  world.add(sc.make<sphere<datatype>>(point3<datatype>(4, 1, 0), 1.0, mat3));
   // auto out_node = bvh_node<datatype>(world, 0.0, 1.0);
   // auto out_node = std::make_shared<node<datatype>>(world, 0.0, 1.0);
   return hit_list<datatype>(
-      std::make_shared<bvh_node<datatype>>(world, 0.0, 0.1));
+      sc.make<bvh_node<datatype>>(world, 0.0, 0.1, sc.mem()));
   // return world;
 }
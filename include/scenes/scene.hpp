@@ -0,0 +1,82 @@
+/**
+ * @file scene.hpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Owner of every object and material of a scene
+ * @details Objects, wrappers and materials only refer to each other through
+ * plain pointers, and hit records carry a plain material pointer, so no
+ * reference count is touched while rendering. The scene keeps everything
+ * alive until it is destroyed, which must outlive the render. Everything is
+ * placed in the scene's arena, grouped by type, and freed all at once.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <utility>
+
+#include "arena.hpp"
+
+/**
+ * @brief Storage for the objects and materials of a scene
+ *
+ * @tparam T Datatype to be used (e.g float, double)
+ */
+template <typename T>
+class scene {
+ public:
+  /**
+   * @brief Construct an empty scene
+   *
+   */
+  scene() {}
+
+  // Everything made by the scene is referred to by address
+  scene(const scene&) = delete;
+  scene& operator=(const scene&) = delete;
+
+  /**
+   * @brief Construct an object, material, texture or wrapper in the scene
+   *
+   * @tparam X Type to construct
+   * @tparam Args Constructor argument types
+   * @param args Constructor arguments
+   * @return X* Pointer that stays valid for the life of the scene
+   */
+  template <typename X, typename... Args>
+  X* make(Args&&... args) {
+    return mem_.make<X>(std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief Number of things the scene owns
+   *
+   * @return size_t Number of objects, materials, textures and wrappers
+   */
+  size_t size() const { return mem_.size(); }
+
+  /**
+   * @brief Arena the scene is stored in, for builders that add their own
+   * nodes (e.g bvh_node)
+   *
+   * @return arena& Arena of the scene
+   */
+  arena& mem() { return mem_; }
+
+  /**
+   * @brief Print how much memory the scene takes, per type
+   *
+   */
+  void print() const { mem_.print(std::cerr); }
+
+ private:
+  /**
+   * @brief Storage of everything made by the scene
+   *
+   */
+  arena mem_;
+};
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "solid.hpp"
 #include "texture.hpp"
 
 // Subclass of uvTex: checker
@@ -33,7 +34,8 @@ class checker : public uvTex<T> {
    * @param even Texture to apply to even squares
    * @param odd Texture to apply to odd squares
    */
-  checker(std::shared_ptr<uvTex<T>> even, std::shared_ptr<uvTex<T>> odd) {}
+  checker(const uvTex<T>* even, const uvTex<T>* odd)
+      : even_(even), odd_(odd) {}
   /**
    * @brief Construct a new checker object from rgb colors
    *
@@ -41,8 +43,11 @@ class checker : public uvTex<T> {
    * @param c2 Color for odd squares
    */
   checker(color<T> c1, color<T> c2)
-      : even_(std::make_shared<solid<T>>(c1)),
-        odd_(std::make_shared<solid<T>>(c2)) {}
+      : even_col_(c1), odd_col_(c2), even_(&even_col_), odd_(&odd_col_) {}
+
+  // Plain colours point the squares at the checker's own solids
+  checker(const checker&) = delete;
+  checker& operator=(const checker&) = delete;
 
   /**
    * @brief Return the value for a point at a given (u,v)
@@ -62,14 +67,19 @@ class checker : public uvTex<T> {
   }
 
  private:
+  /**
+   * @brief Colours of the squares when made from colours
+   *
+   */
+  solid<T> even_col_, odd_col_;
   /**
    * @brief Texture for even squares
    *
    */
-  std::shared_ptr<uvTex<T>> even_;
+  const uvTex<T>* even_{nullptr};
   /**
    * @brief Texture for odd squares
    *
    */
-  std::shared_ptr<uvTex<T>> odd_;
+  const uvTex<T>* odd_{nullptr};
 };
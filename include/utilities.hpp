@@ -16,6 +16,8 @@
 #include <memory>
 #include <vector>
 
+#include "rng.hpp"
+
 // Define our own pi if it isn't for some reason
 #ifndef M_PI
 #define M_PI = 3.14159265358979323846
@@ -66,7 +68,7 @@ inline double deg_to_rad(float deg) {
  */
 template <typename T>
 inline T my_rand() {
-  return std::rand() / (RAND_MAX + 1.0);
+  return static_cast<T>(thread_rng().uniform());
 }
 
 /**
@@ -101,13 +103,36 @@ inline T my_clamp(const T& x, const T& min, const T& max) {
 }
 
 /**
- * @brief Returns random double between 0 and 1
+ * @brief Returns random double between 0 and 1 from an engine
  *
+ * @param g Engine to draw from
  * @return double Random double between 0 and 1
  */
-inline double random_double() {
+inline double random_double(rng& g) {
   // Returns a random real in [0,1).
-  return std::rand() / (RAND_MAX + 1.0);
+  return g.uniform();
+}
+
+/**
+ * @brief Returns random double between 0 and 1 from this thread's engine
+ *
+ * @return double Random double between 0 and 1
+ */
+inline double random_double() {
+  return random_double(thread_rng());
+}
+
+/**
+ * @brief Returns a random number between two values from an engine
+ *
+ * @param min Lower bound for random number
+ * @param max Upper bound for random number
+ * @param g Engine to draw from
+ * @return double Random number between two values
+ */
+inline double random_double(const double& min, const double& max, rng& g) {
+  // Returns a random real in [min,max).
+  return min + (max - min) * random_double(g);
 }
 
 /**
@@ -118,8 +143,7 @@ inline double random_double() {
  * @return double Random number between two values
  */
 inline double random_double(const double& min, const double& max) {
-  // Returns a random real in [min,max).
-  return min + (max - min) * random_double();
+  return random_double(min, max, thread_rng());
 }
 
 /**
@@ -10,6 +10,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 
 #include "utilities.hpp"
@@ -143,22 +144,46 @@ class vec3 {
   /**
    * @brief Return a random vector
    *
+   * @param g Engine to draw from
    * @return vec3 Random vector
    */
-  static vec3 random() {
-    return vec3(random_double(), random_double(), random_double());
+  static vec3 random(rng& g) {
+    T x = random_double(g);
+    T y = random_double(g);
+    T z = random_double(g);
+    return vec3(x, y, z);
   }
+  /**
+   * @brief Return a random vector from this thread's engine
+   *
+   * @return vec3 Random vector
+   */
+  static vec3 random() { return random(thread_rng()); }
 
   /**
    * @brief Returns a vector with components of random value between two input
    *
    * @param t1 Lower bound for random component
    * @param t2 Upper bound for random component
+   * @param g Engine to draw from
+   * @return vec3 Vector with random entries as components
+   */
+  static vec3 random(const T& t1, const T& t2, rng& g) {
+    T x = random_double(t1, t2, g);
+    T y = random_double(t1, t2, g);
+    T z = random_double(t1, t2, g);
+    return vec3(x, y, z);
+  }
+  /**
+   * @brief Returns a vector with components of random value between two input
+   * from this thread's engine
+   *
+   * @param t1 Lower bound for random component
+   * @param t2 Upper bound for random component
    * @return vec3 Vector with random entries as components
    */
   static vec3 random(const T& t1, const T& t2) {
-    return vec3(random_double(t1, t2), random_double(t1, t2),
-                random_double(t1, t2));
+    return random(t1, t2, thread_rng());
   }
 
  private:
@@ -335,45 +360,126 @@ inline vec3<T> refract(const vec3<T>& uv, const vec3<T>& n, T etai_over_etat) {
  * @brief Return a random unit vector in a disk
  *
  * @tparam T Datatype to use (e.g float, double)
+ * @param g Engine to draw from
  * @return vec3<T> Random unit vector in a disk
  */
 template <typename T>
-inline vec3<T> random_disk_hat() {
+inline vec3<T> random_disk_hat(rng& g) {
   while (true) {
-    vec3<T> p =
-        vec3<T>(random_double(static_cast<T>(-1.0), static_cast<T>(1.0)),
-                random_double(static_cast<T>(-1.0), static_cast<T>(1.0)), 0);
+    T x = random_double(static_cast<T>(-1.0), static_cast<T>(1.0), g);
+    T y = random_double(static_cast<T>(-1.0), static_cast<T>(1.0), g);
+    vec3<T> p = vec3<T>(x, y, 0);
     if (p.norm_sqr() >= 1)
       continue;
     return p;
   }
 }
 
+/**
+ * @brief Return a random unit vector in a disk from this thread's engine
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @return vec3<T> Random unit vector in a disk
+ */
+template <typename T>
+inline vec3<T> random_disk_hat() {
+  return random_disk_hat<T>(thread_rng());
+}
+
+/**
+ * @brief Map a point of the unit square onto the unit disk
+ * @details Concentric mapping (Shirley and Chiu), which keeps neighbouring
+ * points of the square close on the disk, so the stratification of a
+ * sampler carries over. Rejection sampling would throw it away.
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @param a First coordinate in [0,1)
+ * @param b Second coordinate in [0,1)
+ * @return vec3<T> Point in the disk of the xy plane
+ */
+template <typename T>
+inline vec3<T> disk_point(const T& a, const T& b) {
+  const T x = 2 * a - 1;
+  const T y = 2 * b - 1;
+  if (x == 0 && y == 0)
+    return vec3<T>(0, 0, 0);
+  const T q = static_cast<T>(M_PI / 4);
+  T r, phi;
+  if (std::fabs(x) > std::fabs(y)) {
+    r = x;
+    phi = q * (y / x);
+  } else {
+    r = y;
+    phi = 2 * q - q * (x / y);
+  }
+  return vec3<T>(r * std::cos(phi), r * std::sin(phi), 0);
+}
+
+/**
+ * @brief Map a point of the unit square onto the unit sphere, uniformly
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @param a First coordinate in [0,1)
+ * @param b Second coordinate in [0,1)
+ * @return vec3<T> Unit vector
+ */
+template <typename T>
+inline vec3<T> sphere_point(const T& a, const T& b) {
+  const T z = 1 - 2 * a;
+  const T r = std::sqrt(std::max(static_cast<T>(0), 1 - z * z));
+  const T phi = static_cast<T>(2 * M_PI) * b;
+  return vec3<T>(r * std::cos(phi), r * std::sin(phi), z);
+}
+
 /**
  * @brief Return a random vector in a sphere
  *
  * @tparam T Datatype to use (e.g float, double)
+ * @param g Engine to draw from
  * @return vec3<T> Random vector in a sphere
  */
 template <typename T>
-inline vec3<T> random_sphere() {
+inline vec3<T> random_sphere(rng& g) {
   while (true) {
-    vec3<T> p = vec3<T>::random(static_cast<T>(-1.0), static_cast<T>(1.0));
+    vec3<T> p = vec3<T>::random(static_cast<T>(-1.0), static_cast<T>(1.0), g);
     if (p.norm_sqr() >= 1)
       continue;
     return p;
   }
 }
 
+/**
+ * @brief Return a random vector in a sphere from this thread's engine
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @return vec3<T> Random vector in a sphere
+ */
+template <typename T>
+inline vec3<T> random_sphere() {
+  return random_sphere<T>(thread_rng());
+}
+
 /**
  * @brief Return a random unit vector in spherical coordinates
  *
  * @tparam T Datatype to use (e.g float, double)
+ * @param g Engine to draw from
+ * @return vec3<T> Random unit vector in spherical coordinates
+ */
+template <typename T>
+inline vec3<T> random_unit_v(rng& g) {
+  return unit_v<T>(random_sphere<T>(g));
+}
+
+/**
+ * @brief Return a random unit vector from this thread's engine
+ *
+ * @tparam T Datatype to use (e.g float, double)
  * @return vec3<T> Random unit vector in spherical coordinates
  */
 template <typename T>
 inline vec3<T> random_unit_v() {
-  return unit_v<T>(random_sphere<T>());
+  return random_unit_v<T>(thread_rng());
 }
 
 /**
@@ -381,17 +487,30 @@ inline vec3<T> random_unit_v() {
  *
  * @tparam T Datatype to use (e.g float, double)
  * @param n Normal of hemisphere
+ * @param g Engine to draw from
  * @return vec3<T> Random vector in hemisphere
  */
 template <typename T>
-inline vec3<T> random_half_sphere(const vec3<T>& n) {
-  vec3<T> in_sphere = random_sphere<T>();
+inline vec3<T> random_half_sphere(const vec3<T>& n, rng& g) {
+  vec3<T> in_sphere = random_sphere<T>(g);
   if (dot<T>(in_sphere, n) > 0.0)
     return in_sphere;
   else
     return -in_sphere;
 }
 
+/**
+ * @brief Return a random vector in hemi-sphere from this thread's engine
+ *
+ * @tparam T Datatype to use (e.g float, double)
+ * @param n Normal of hemisphere
+ * @return vec3<T> Random vector in hemisphere
+ */
+template <typename T>
+inline vec3<T> random_half_sphere(const vec3<T>& n) {
+  return random_half_sphere<T>(n, thread_rng());
+}
+
 // These convenient aliases will make tracking data easier
 template <typename T>
 using point3 = vec3<T>;
@@ -15,10 +15,23 @@
 #include "config_parser.hpp"
 #include "timer.hpp"
 
+#include "io/async_writer.hpp"
+#include "io/image_writer.hpp"
+#include "io/tile_file.hpp"
+
+#include "objects/bvh.hpp"
+#include "objects/closed_bvh.hpp"
 #include "objects/hit_list.hpp"
+#include "objects/linear_bvh.hpp"
 
 #include "render/camera.hpp"
+#include "render/checkpoint.hpp"
 #include "render/color.hpp"
+#include "render/light_list.hpp"
+#include "render/renderer.hpp"
+#include "render/sampler.hpp"
+#include "render/shard.hpp"
+#include "scenes/scene.hpp"
 
 // #include "scenes/cornell_box.hpp"
 // #include "scenes/light_scene.hpp"
@@ -34,11 +47,37 @@
  * @return int Success/Error code
  */
 int main(int argc, char* argv[]) {
-  std::string file_name;
-  if (argc < 2)
-    file_name = "low.rt";
-  else
-    file_name = argv[1];
+  // Usage: main [config] [--resume] [--time seconds] [--crop x0,y0,x1,y1]
+  //             [--worker dir | --coordinate dir]
+  timer t_total;
+  std::string file_name = "low.rt";
+  bool resume = false;
+  double budget = -1;
+  tile crop{0, 0, 0, 0};
+  bool cropped = false;
+  std::string queue_dir;
+  bool coordinate = false;
+  for (int k = 1; k < argc; k++) {
+    const std::string arg = argv[k];
+    if (arg == "--resume") {
+      resume = true;
+    } else if (arg == "--time" && k + 1 < argc) {
+      budget = std::atof(argv[++k]);
+    } else if (arg == "--crop" && k + 1 < argc) {
+      char rest;
+      if (std::sscanf(argv[++k], "%d,%d,%d,%d%c", &crop.x0, &crop.y0,
+                      &crop.x1, &crop.y1, &rest) != 4) {
+        std::cerr << "--crop takes x0,y0,x1,y1, not " << argv[k] << ".\n";
+        return 1;
+      }
+      cropped = true;
+    } else if ((arg == "--worker" || arg == "--coordinate") && k + 1 < argc) {
+      coordinate = arg == "--coordinate";
+      queue_dir = argv[++k];
+    } else {
+      file_name = arg;
+    }
+  }
   std::unordered_map<std::string, double> opts;
   std::unordered_map<std::string, vec3<double>> vec_opts;
 
@@ -54,13 +93,42 @@ int main(int argc, char* argv[]) {
   const int max_depth{static_cast<int>(opts["max_depth"])};
   const color<datatype> bg{vec_opts["bg"]};
 
-  // World
+  // BVH builder used by the scenes (0: random axis median, 1: SAH)
+  if (opts.count("bvh_split"))
+    bvh_defaults().split =
+        opts["bvh_split"] > 0 ? bvh_split::sah : bvh_split::median;
+  if (opts.count("bvh_bins"))
+    bvh_defaults().bins = static_cast<int>(opts["bvh_bins"]);
+  if (opts.count("bvh_leaf"))
+    bvh_defaults().leaf_size = static_cast<size_t>(opts["bvh_leaf"]);
+
+  // World, everything in it lives as long as the scene
   timer t_scene;
-  hit_list<datatype> world = mesh_scene();
+  scene<datatype> sc;
+  hit_list<datatype> world = mesh_scene(sc);
+  // Emitters for light sampling, collected before the world is flattened
+  // (integrator 0: path tracing, 1: light sampling, 2: MIS, 3: AO)
+  const int mode{static_cast<int>(opts["integrator"])};
+  light_list<datatype> lights;
+  if (mode == 1 || mode == 2) {
+    lights = light_list<datatype>(world);
+    std::cerr << "Light sampling: " << lights.size() << " emitters.\n";
+  }
+  // Flatten the whole scene into one array-of-nodes BVH for traversal
+  // or, with closed_world, into one whose built-in primitives are inlined
+  if (opts["closed_world"] > 0) {
+    auto cw = sc.make<closed_bvh<datatype>>(world, 0.0, 1.0);
+    std::cerr << "Closed world: " << cw->size() << " primitives, "
+              << cw->virtual_size() << " through hit<T>.\n";
+    world = hit_list<datatype>(cw);
+  } else if (!opts.count("bvh_flat") || opts["bvh_flat"] > 0) {
+    world = hit_list<datatype>(sc.make<linear_bvh<datatype>>(world, 0.0, 1.0));
+  }
   t_scene.end();
   double t_end = t_scene.seconds();
   if (t_end > 1.0)
     std::cerr << "Time to build scene: " << t_end << " seconds.\n";
+  sc.print();
 
   // Camera
   point3<datatype> from(vec_opts["from"]);
@@ -73,65 +141,242 @@ int main(int argc, char* argv[]) {
   const datatype focus{opts["focus"]};
   const datatype ap{opts["ap"]};
   camera<datatype> cam(from, to, vup, vof, aspect, ap, focus, 0.0, 1.0);
-  //   Render our scene
-  //   .ppm file size widthxheight
-  std::cout << "P3\n" << width << " " << height << "\n255\n";
+  // Render our scene over every core, tile by tile
+  render_settings<datatype> set;
+  set.width = width;
+  set.height = height;
+  set.ns = ns;
+  // Adaptive sampling between min_spp and max_spp samples per pixel, on
+  // when adapt_err is given
+  if (opts["adapt_err"] > 0) {
+    set.adapt_err = static_cast<datatype>(opts["adapt_err"]);
+    set.min_spp = opts["min_spp"] > 0 ? static_cast<int>(opts["min_spp"]) : 16;
+    if (opts["max_spp"] > 0)
+      set.ns = static_cast<int>(opts["max_spp"]);
+  }
+  set.max_depth = max_depth;
+  // Russian roulette from bounce rr_depth on, off when not given
+  if (opts.count("rr_depth"))
+    set.rr.depth = static_cast<int>(opts["rr_depth"]);
+  if (opts.count("rr_prob"))
+    set.rr.max_prob = static_cast<datatype>(opts["rr_prob"]);
+  set.lights = &lights;
+  set.mode = mode >= 3   ? integrator::ao
+             : mode == 2 ? integrator::mis
+             : mode == 1 ? integrator::nee
+                         : integrator::path;
+  if (opts["ao_dist"] > 0)
+    set.ao_dist = static_cast<datatype>(opts["ao_dist"]);
+  // Sampler of the camera, scatter and light samples (0: independent,
+  // 1: stratified, 2: Sobol, 3: Halton)
+  const int kind{static_cast<int>(opts["sampler"])};
+  std::unique_ptr<sampler> smp = make_sampler(
+      kind >= 3   ? sampler_kind::halton
+      : kind == 2 ? sampler_kind::sobol
+      : kind == 1 ? sampler_kind::stratified
+                  : sampler_kind::independent,
+      set.adapt_err > 0 ? set.min_spp : set.ns);
+  set.smp = smp.get();
+  set.bg = bg;
+  set.tile_size = opts["tile"] > 0 ? static_cast<int>(opts["tile"]) : 16;
 
-  // TODO: This whole thing can be subdivided for parallelism
-  // also TODO: probably want this in a function
-  //            -> assign parallelism from this func?
-  // Let's time this, it's not going to be pretty
-  timer t_render;
+  // Progressive passes of pass_spp samples, checkpointed every checkpoint
+  // seconds and when stopped by SIGINT or SIGTERM
+  set.pass_spp = static_cast<int>(opts["pass_spp"]);
+  set.stop = &stop_flag();
+  catch_stop_signals();
+
+  // threads=0, or below, uses every hardware thread
+  thread_pool pool(static_cast<unsigned>(std::max(opts["threads"], 0.0)));
+
+  // Image on stdout (0: text .ppm, 1: binary .ppm, 2: .pfm, 3: OpenEXR,
+  // 4: .png), tonemapped for .ppm and .png
+  const image_format format = format_of(static_cast<int>(opts["format"]));
+
+  // Renders split over processes (see render/shard.hpp) are put back
+  // together from tiles, which must all come from the same settings. Those
+  // that only change how the render runs are left out. A checkpoint may
+  // also be resumed with more samples per pixel than it was started with.
+  std::vector<std::string> run_only{
+      "threads", "tile",    "pass_spp",    "checkpoint", "preview",
+      "format",  "spp_map", "time_budget", "shard_size", "shard_timeout"};
+  const uint64_t config = parser.fingerprint(run_only);
+  run_only.insert(run_only.end(), {"ns", "max_spp"});
+  const uint64_t ckpt_config = parser.fingerprint(run_only);
+
+  // --worker renders the windows queued in a directory until none are
+  // left, --coordinate queues them first, renders along, waits for the
+  // other workers and writes the merged image on stdout
+  if (!queue_dir.empty()) {
+    shard_queue q(queue_dir);
+    if (coordinate) {
+      const int size = opts["shard_size"] > 0
+                           ? static_cast<int>(opts["shard_size"])
+                           : 256;
+      std::cerr << "Queued " << q.create(width, height, size)
+                << " windows in " << queue_dir << ".\n";
+    }
+    timer t_render;
+    size_t rendered = 0;
+    bool failed = false;
+    while (!failed) {
+      tile win;
+      while (!stop_flag().load() && q.claim(win)) {
+        framebuffer<datatype> part(win.x1 - win.x0, win.y1 - win.y0, win.x0,
+                                   height - win.y1);
+        if (render(cam, world, set, part, pool) != render_end::done ||
+            !q.finish(make_tile(part, width, height, config))) {
+          q.release();
+          failed = !stop_flag().load();
+          break;
+        }
+        rendered++;
+      }
+      if (!coordinate || stop_flag().load() || q.waiting() == 0)
+        break;
+      // Other workers are still at it. Windows claimed for longer than
+      // shard_timeout seconds are taken to be lost and queued again.
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      if (opts["shard_timeout"] > 0)
+        q.requeue_stale(opts["shard_timeout"]);
+    }
+    t_render.end();
+    std::cerr << "\n" << rendered << " windows rendered here in "
+              << t_render.seconds() / 60 << " minutes.\n";
+    if (failed)
+      std::cerr << "Could not write a tile to " << queue_dir << ".\n";
+    if (!coordinate || failed || stop_flag().load())
+      return failed ? 1 : 0;
 
-  //   color<double>* pixels = new color<double>[width * height];
-  //   color<double> pix = color<double>(0, 0, 0);
-  // #pragma omp parallel for private(pix)
-  //   for (int i = 0; i < width * height; i++) {
-  //     // pixels[i] = color<double>(0, 0, 0);
-  //     // std::cerr << "\rLines remaining: " << height - ((i - (i % width)) /
-  //     // width)
-  //     //           << " " << std::flush;
-  //     for (int s = 0; s < ns; ++s) {
-  //       int x, y;
-  //       x = i % width;
-  //       y = ((i - (i % width)) / width);
-  //       datatype u = static_cast<datatype>(x + random_double()) / (width -
-  //       1); datatype v = static_cast<datatype>(y + random_double()) / (height
-  //       - 1); ray<datatype> r = cam.getRay(u, v); pix += ray_color(r, bg,
-  //       world, max_depth); pixels[i] = pix;
-  //     }
-  //     printf("HERE %d\n", i);
-  //   }
-
-  //   for (int j = height - 1; j >= 0; j--) {
-  //     for (int i = 0; i < width; i++) {
-  //       size_t px = j * width + i;
-  //       write_color<datatype>(std::cout, pixels[px], ns);
-  //     }
-  //   }
-
-  // Print out r,g,b values for our scene
-  for (int j = height - 1; j >= 0; --j) {
-    //   Use std::cerr to print to terminal while writing file
-    std::cerr << "\rLines remaining: " << j << " " << std::flush;
-    for (int i = 0; i < width; ++i) {
-      color<datatype> px(0, 0, 0);
-      // #pragma omp parallel
-      // {
-      // Let's try something quick while I work, bad renders are ok for now
-      // #pragma omp for reduction(+ : px)
-      // ->this reduction is messy to code, do by hand instead
-      for (int s = 0; s < ns; ++s) {
-        datatype u = static_cast<datatype>(i + random_double()) / (width - 1);
-        datatype v = static_cast<datatype>(j + random_double()) / (height - 1);
-        ray<datatype> r = cam.getRay(u, v);
-        px += ray_color(r, bg, world, max_depth);
-        // }
+    std::vector<image_tile> tiles;
+    for (const std::string& path : q.done()) {
+      tiles.emplace_back();
+      if (!load_tile(path, tiles.back()) || tiles.back().config != config) {
+        std::cerr << "Skipping " << path
+                  << ", not a tile of these settings.\n";
+        tiles.pop_back();
       }
-      write_color<datatype>(std::cout, px, ns);
     }
+    hdr_image merged;
+    std::string err;
+    if (!merge_tiles(tiles, merged, err)) {
+      std::cerr << "Could not merge the tiles: " << err << ".\n";
+      return 1;
+    }
+    write_image(std::cout, merged, format, &pool);
+    return 0;
+  }
+
+  // --crop renders only a window of the image, given by its top left and
+  // bottom right corners, and writes it on stdout as a tile
+  if (cropped) {
+    crop.x0 = std::max(crop.x0, 0);
+    crop.y0 = std::max(crop.y0, 0);
+    crop.x1 = std::min(crop.x1, width);
+    crop.y1 = std::min(crop.y1, height);
+    if (crop.x1 <= crop.x0 || crop.y1 <= crop.y0) {
+      std::cerr << "The --crop window holds no pixel of the " << width << "x"
+                << height << " image.\n";
+      return 1;
+    }
+  } else {
+    crop = tile{0, 0, width, height};
+  }
+  framebuffer<datatype> fb(crop.x1 - crop.x0, crop.y1 - crop.y0, crop.x0,
+                           height - crop.y1);
+  const std::string ckpt_name =
+      file_name +
+      (cropped ? "." + std::to_string(crop.x0) + "_" +
+                     std::to_string(crop.y0) + "_" +
+                     std::to_string(crop.x1) + "_" +
+                     std::to_string(crop.y1)
+               : std::string()) +
+      ".ckpt";
+  if (resume) {
+    if (load_checkpoint(ckpt_name, fb, ckpt_config))
+      std::cerr << "Resuming from " << ckpt_name << " at "
+                << fb.min_samples() << " samples per pixel.\n";
+    else
+      std::cerr << "No checkpoint of this image and settings in "
+                << ckpt_name << ", starting over.\n";
   }
+
+  // With a time budget (from the config or --time, counted from the start)
+  // the render ends in time with as many samples as fit, up to ns
+  if (budget < 0)
+    budget = opts["time_budget"];
+  if (budget > 0) {
+    t_total.end();
+    set.time_budget = std::max(budget - t_total.seconds(), 1e-3);
+  }
+
+  // Checkpoints, and every preview seconds the image so far, are written
+  // on a thread of their own while the next pass renders. Each job holds
+  // its own copy of the state it writes.
+  async_writer io;
+  const std::string preview_name =
+      file_name + ".preview" + extension(format);
+  const double preview_every{opts["preview"]};
+  auto checkpoint = [&](const bool& last) {
+    io.push([snap = fb, &ckpt_name, ckpt_config, last] {
+      const bool ok = save_checkpoint(ckpt_name, snap, ckpt_config);
+      if (last)
+        std::cerr << (ok ? "continue with --resume from "
+                         : "could not write ")
+                  << ckpt_name << ".";
+      else if (!ok)
+        std::cerr << "\nCould not write " << ckpt_name << ".\n";
+    });
+  };
+
+  // Let's time this, it's not going to be pretty
+  timer t_render;
+  timer t_ckpt;
+  timer t_preview;
+  const double ckpt_every{opts["checkpoint"]};
+  const render_end end = render(cam, world, set, fb, pool, [&](int) {
+    t_ckpt.end();
+    if (ckpt_every > 0 && t_ckpt.seconds() >= ckpt_every) {
+      checkpoint(false);
+      t_ckpt = timer();
+    }
+    t_preview.end();
+    if (preview_every > 0 && t_preview.seconds() >= preview_every) {
+      io.push([img = fb.resolve(), &preview_name, format] {
+        if (!save_image(preview_name, img, format))
+          std::cerr << "\nCould not write " << preview_name << ".\n";
+      });
+      t_preview = timer();
+    }
+  });
+  if (end != render_end::done) {
+    std::cerr << (end == render_end::stopped ? "\nStopped, "
+                                             : "\nOut of time, ");
+    checkpoint(true);
+  }
+  io.wait();
+
+  if (cropped)
+    write_tile(std::cout, make_tile(fb, width, height, config));
+  else
+    write_image(std::cout, fb.resolve(), format, &pool);
+  std::cout.flush();
   t_render.end();
+  std::cerr << "\nSamples per pixel: "
+            << static_cast<double>(fb.total_samples()) /
+                   (static_cast<double>(fb.width()) * fb.height())
+            << " on average, " << fb.min_samples() << " at least";
+  if (set.adapt_err > 0)
+    std::cerr << " (adaptive, " << set.min_spp << " to " << set.ns << ")";
+  std::cerr << ". Estimated noise: " << 255 * fb.noise()
+            << " steps of 255 (RMS standard error).";
+  // Map of the samples taken per pixel, white at the most
+  if (opts["spp_map"] > 0) {
+    const std::string map_name = file_name + ".spp.pgm";
+    std::ofstream map(map_name);
+    fb.write_samples(map, set.ns);
+    std::cerr << "\nSample map written to " << map_name << ".";
+  }
   std::cerr << "\nFinished Render in " << t_render.seconds() / 60
-            << " minutes.\n";
+            << " minutes on " << pool.size() << " threads.\n";
 }
@@ -0,0 +1,64 @@
+/**
+ * @file merge.cpp
+ * @author Dylan Bassi (bassidj@mcmaster.ca)
+ * @brief Companion tool that puts the tiles of a split render back together
+ * @details Tiles come from --crop, or from the done/ directory of a queue
+ * rendered by --worker processes. The image is written on stdout.
+ * @version 0.1
+ * @date 2020-12-04
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "io/image_writer.hpp"
+#include "io/tile_file.hpp"
+
+/**
+ * @brief Merge the tiles given on the command line
+ *
+ * @param argc Number of arguments
+ * @param argv Vector of arguments
+ * @return int Success/Error code
+ */
+int main(int argc, char* argv[]) {
+  // Usage: merge_tiles [--format n] tiles or directories of tiles > image
+  // (format as in the config, .png by default)
+  image_format format = image_format::png;
+  std::vector<std::string> paths;
+  for (int k = 1; k < argc; k++) {
+    const std::string arg = argv[k];
+    if (arg == "--format" && k + 1 < argc) {
+      format = format_of(std::atoi(argv[++k]));
+    } else if (std::filesystem::is_directory(arg)) {
+      for (const auto& e : std::filesystem::directory_iterator(arg))
+        if (e.path().extension() == ".rtile")
+          paths.push_back(e.path().string());
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  std::vector<image_tile> tiles(paths.size());
+  for (size_t k = 0; k < paths.size(); k++)
+    if (!load_tile(paths[k], tiles[k])) {
+      std::cerr << paths[k] << " is not a tile.\n";
+      return 1;
+    }
+  hdr_image img;
+  std::string err;
+  if (!merge_tiles(tiles, img, err)) {
+    std::cerr << "Could not merge the tiles: " << err << ".\n";
+    return 1;
+  }
+  thread_pool pool;
+  if (!write_image(std::cout, img, format, &pool))
+    return 1;
+  std::cerr << "Merged " << tiles.size() << " tiles into a " << img.width
+            << "x" << img.height << " image.\n";
+}